@@ -0,0 +1,677 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "kdb.hpp"
+#include "helpers.hpp"
+#include "results.hpp"
+
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░ Allocations ░░░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+static thread_local size_t g_allocations{0};
+
+// The whole replaceable set, kept out of line so the optimiser never sees a malloc
+// paired with a library delete (or the other way round) after inlining.
+__attribute__((noinline)) static void* counted_new(size_t size)
+{
+  g_allocations++;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+
+__attribute__((noinline)) void* operator new  (size_t size)  { return counted_new(size); }
+__attribute__((noinline)) void* operator new[](size_t size)  { return counted_new(size); }
+__attribute__((noinline)) void* operator new  (size_t size, const std::nothrow_t&) noexcept
+{
+  try { return counted_new(size); } catch (...) { return nullptr; }
+}
+__attribute__((noinline)) void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  try { return counted_new(size); } catch (...) { return nullptr; }
+}
+
+__attribute__((noinline)) void operator delete  (void* p)                               noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p)                               noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete  (void* p, size_t)                       noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t)                       noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete  (void* p, const std::nothrow_t&)        noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, const std::nothrow_t&)        noexcept { std::free(p); }
+
+#ifndef KDB_BENCH_REVISION
+#define KDB_BENCH_REVISION "unknown"
+#endif
+
+namespace
+{
+using namespace kdb;
+using Clock = std::chrono::steady_clock;
+
+struct Measurement
+{
+  std::string suite;
+  std::string name;
+  size_t      iterations;
+  size_t      items;          // rows or statements handled per iteration
+  double      ns_per_op;
+  double      allocs_per_op;
+};
+
+std::vector<Measurement> g_results;
+//----------------------------------------------------
+template <typename F>
+void measure(const std::string& suite, const std::string& name, size_t iterations, size_t items, F&& f)
+{
+  f(); // warm up caches, the statement buffer and the connection pool
+
+  const size_t allocations = g_allocations;
+  const auto   start       = Clock::now();
+  for (size_t i = 0; i < iterations; i++)
+    f();
+  const auto   elapsed     = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+  g_results.push_back(Measurement{suite, name, iterations, items, elapsed / iterations,
+                                  static_cast<double>(g_allocations - allocations) / iterations});
+  const auto& m = g_results.back();
+  std::cerr << std::left << std::setw(8) << suite << std::setw(44) << name << std::right
+            << std::setw(14) << std::fixed << std::setprecision(1) << m.ns_per_op << " ns/op"
+            << std::setw(10) << m.allocs_per_op << " allocs/op";
+  if (items > 1)
+    std::cerr << std::setw(14) << std::setprecision(0) << items * 1e9 / m.ns_per_op << " items/s";
+  std::cerr << '\n';
+}
+//----------------------------------------------------
+template <typename T>
+void bench_select(const std::string& name, const T& query, size_t iterations)
+{
+  for (const bool prepare : {false, true})
+    measure("sql", name + (prepare ? "/prepared" : "/literal"), iterations, 1, [&]
+    {
+      Binder binder{prepare};
+      const std::string sql = select_statement(query, binder);
+      (void)(sql);
+    });
+}
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░ SQL generation ░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+void run_sql(size_t iterations)
+{
+  using CompVariant        = std::vector<std::variant<CompFilter, CompBetweenFilter>>;
+  using CompOptionVariant  = std::vector<std::variant<CompFilter, CompBetweenFilter, MultiOptionFilter>>;
+  using BetweenVariant     = std::vector<std::variant<CompBetweenFilter, QueryFilter>>;
+  using ComparisonVariant  = std::vector<std::variant<QueryComparisonFilter, QueryFilter>>;
+
+  const Fields fields{"id", "name", "value", "created"};
+  const Joins  joins {Join{"owners", "id", "tasks", "owner", INNER}, Join{"teams", "id", "owners", "team", OUTER}};
+
+  bench_select("DatabaseQuery", DatabaseQuery{
+    .table = "tasks", .fields = fields, .type = QueryType::SELECT, .values = {},
+    .filter = CreateFilter("name", "task", "value", "10")}, iterations);
+
+  bench_select("DatabaseQuery/in", DatabaseQuery{
+    .table = "tasks", .fields = fields, .type = QueryType::SELECT, .values = {},
+    .filter = CreateFilter("id", "1", "id", "2", "id", "3", "id", "4")}, iterations);
+
+  bench_select("ComparisonSelectQuery", ComparisonSelectQuery{
+    {}, "tasks", fields, {}, {FTuple{"value", ">", "10"}}}, iterations);
+
+  bench_select("ComparisonBetweenSelectQuery", ComparisonBetweenSelectQuery{
+    {}, "tasks", fields, {}, {CompFilter{"value", "10", ">"}}}, iterations);
+
+  bench_select("MultiFilterSelect", MultiFilterSelect{
+    "tasks", fields, {GenericFilter{"value", "10", ">"}, GenericFilter{"name", "'task'", "="}}, {}, {}},
+    iterations);
+
+  bench_select("MultiVariant<Comp,Between>", MultiVariantFilterSelect<CompVariant>{
+    "tasks", fields, {CompFilter{"value", "10", ">"}, CompBetweenFilter{"created", "'2020-01-01'", "'2021-01-01'"}},
+    {"created", "DESC"}, {"100"}}, iterations);
+
+  bench_select("MultiVariant<Comp,Between,Option>", MultiVariantFilterSelect<CompOptionVariant>{
+    "tasks", fields, {CompFilter{"value", "10", ">"}, MultiOptionFilter{"id", "IN", {"1", "2", "3"}}},
+    {"created", "DESC"}, {"100"}}, iterations);
+
+  bench_select("MultiVariant<Between,QueryFilter>", MultiVariantFilterSelect<BetweenVariant>{
+    "tasks", fields, {CompBetweenFilter{"value", "1", "10"}, CreateFilter("name", "task")}, {}, {}}, iterations);
+
+  bench_select("MultiVariant<Comparison,QueryFilter>", MultiVariantFilterSelect<ComparisonVariant>{
+    "tasks", fields, {QueryComparisonFilter{FTuple{"value", "<", "10"}}, CreateFilter("name", "task")}, {}, {}},
+    iterations);
+
+  {
+    JoinQuery<CompOptionVariant> query;
+    query.table  = "tasks";
+    query.fields = fields;
+    query.filter = {CompFilter{"value", "10", ">"}, MultiOptionFilter{"owners.id", "IN", {"1", "2"}}};
+    query.joins  = joins;
+    bench_select("JoinQuery<Comp,Between,Option>", query, iterations);
+  }
+  {
+    JoinQuery<std::vector<QueryFilter>> query;
+    query.table  = "tasks";
+    query.fields = fields;
+    query.filter = {CreateFilter("name", "task"), CreateFilter("owners.name", "someone")};
+    query.joins  = joins;
+    bench_select("JoinQuery<vector<QueryFilter>>", query, iterations);
+  }
+  {
+    JoinQuery<QueryFilter> query;
+    query.table  = "tasks";
+    query.fields = fields;
+    query.filter = CreateFilter("name", "task");
+    query.joins  = joins;
+    bench_select("JoinQuery<QueryFilter>", query, iterations);
+  }
+  bench_select("SimpleJoinQuery", SimpleJoinQuery{
+    "tasks", fields, CreateFilter("name", "task"), joins.front(), {}, {}}, iterations);
+
+  const Values values{"task", "10", "2020-01-01", "task", "11", "2020-01-02"};
+  for (const bool prepare : {false, true})
+  {
+    const std::string mode = prepare ? "/prepared" : "/literal";
+    measure("sql", "insert_statement" + mode, iterations, 1, [&]
+    {
+      Binder binder{prepare};
+      const std::string sql = insert_statement(DatabaseQuery{
+        .table = "tasks", .fields = {"name", "value", "created"}, .type = QueryType::INSERT,
+        .values = values, .filter = {}}, binder);
+    });
+    measure("sql", "insert_statement/returning" + mode, iterations, 1, [&]
+    {
+      Binder binder{prepare};
+      const std::string sql = insert_statement(InsertReturnQuery{
+        {}, "tasks", {"name", "value", "created"}, QueryType::INSERT, values, "id"}, "id", binder);
+    });
+    measure("sql", "update_statement" + mode, iterations, 1, [&]
+    {
+      Binder binder{prepare};
+      const std::string sql = update_statement(UpdateReturnQuery{
+        .table = "tasks", .fields = {"name", "value"}, .values = {"task", "12"},
+        .filter = CreateFilter("id", "1"), .returning = "id"}, "id", binder);
+    });
+    measure("sql", "delete_statement" + mode, iterations, 1, [&]
+    {
+      Binder binder{prepare};
+      const std::string sql = delete_statement(DatabaseQuery{
+        .table = "tasks", .fields = {}, .type = QueryType::DELETE, .values = {},
+        .filter = CreateFilter("id", "1")}, binder);
+    });
+  }
+}
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░ End to end ░░░░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+std::string env(const char* name, const char* fallback = "")
+{
+  const char* value = std::getenv(name);
+  return (value) ? value : fallback;
+}
+//----------------------------------------------------
+dbconfig bench_config()
+{
+  dbconfig config{};
+  config.credentials = identification{env("KDB_BENCH_USER", "kdb"), env("KDB_BENCH_PASSWORD", "kdb"),
+                                      env("KDB_BENCH_NAME")};
+  config.address     = env("KDB_BENCH_HOST", "127.0.0.1");
+  config.port        = env("KDB_BENCH_PORT", "5432");
+  return config;
+}
+//----------------------------------------------------
+std::string connection_string(const dbconfig& config)
+{
+  return "dbname = "    + config.credentials.name     + " user = " + config.credentials.user +
+         " password = " + config.credentials.password + " hostaddr = " + config.address      +
+         " port = "     + config.port;
+}
+//----------------------------------------------------
+KDB make_kdb(dbconfig config)
+{
+  return KDB{std::make_unique<db_cxn>(), config};
+}
+//----------------------------------------------------
+void reset_table(const dbconfig& config, size_t rows)
+{
+  pqxx::connection connection{connection_string(config)};
+  pqxx::work       worker{connection};
+  worker.exec("DROP TABLE IF EXISTS kdb_bench");
+  worker.exec("CREATE TABLE kdb_bench (id SERIAL PRIMARY KEY, name TEXT, value INTEGER, "
+              "created TIMESTAMPTZ DEFAULT now())");
+  worker.exec("INSERT INTO kdb_bench (name, value) SELECT 'row ' || i, i FROM generate_series(1, " +
+              std::to_string(rows) + ") AS i");
+  worker.commit();
+}
+//----------------------------------------------------
+Values make_rows(size_t rows)
+{
+  Values values;
+  values.reserve(rows * 2);
+  for (size_t i = 0; i < rows; i++)
+  {
+    values.emplace_back("row " + std::to_string(i));
+    values.emplace_back(std::to_string(i));
+  }
+  return values;
+}
+//----------------------------------------------------
+struct BenchRow
+{
+  int64_t                id;
+  std::string            name;
+  std::optional<int64_t> value;
+};
+} // ns
+
+template <>
+struct kdb::row_traits<BenchRow>
+{
+  static constexpr auto columns = std::make_tuple(column("id",    &BenchRow::id),
+                                                  column("name",  &BenchRow::name),
+                                                  column("value", &BenchRow::value));
+};
+
+namespace
+{
+//----------------------------------------------------
+/**
+ * Runs `call` with lvalue arguments, with temporaries, and with arguments built
+ * beforehand and moved in, then fails the run unless the lvalue and temporary cases
+ * each cost exactly one copy of `args` more than the moved one: a copy at the
+ * parameter, or building the temporaries, and none on the way to the statement builder.
+ */
+template <typename F, typename... Args>
+void check_copies(const std::string& name, size_t iterations, F&& call, const Args&... args)
+{
+  size_t copy_cost{0};
+  {
+    const size_t        allocations = g_allocations;
+    std::tuple<Args...> copy{args...};
+    copy_cost = g_allocations - allocations;
+  }
+
+  std::vector<std::tuple<Args...>> prebuilt(iterations + 1, std::tuple<Args...>{args...});
+  size_t                           next{0};
+
+  measure("e2e", name + "/lvalue_args", iterations, 1, [&] { call(args...); });
+  const double lvalue = g_results.back().allocs_per_op;
+  measure("e2e", name + "/rvalue_args", iterations, 1, [&] { call(Args{args}...); });
+  const double rvalue = g_results.back().allocs_per_op;
+  measure("e2e", name + "/moved_args",  iterations, 1, [&] { std::apply(call, std::move(prebuilt[next++])); });
+  const double moved  = g_results.back().allocs_per_op;
+
+  if (std::abs(lvalue - moved - copy_cost) > 0.5 || std::abs(rvalue - moved - copy_cost) > 0.5)
+    throw std::runtime_error{name + " copies its arguments: " + std::to_string(lvalue) + " / " +
+                             std::to_string(rvalue) + " / " + std::to_string(moved) +
+                             " allocs/op with lvalue / rvalue / moved arguments, one copy is " +
+                             std::to_string(copy_cost)};
+}
+//----------------------------------------------------
+void run_e2e(size_t rows, size_t iterations)
+{
+  const dbconfig config = bench_config();
+  const Fields   fields{"id", "name", "value", "created"};
+  reset_table(config, rows);
+
+  // Per-query latency: a fresh connection per call, as db_cxn did before pooling
+  measure("e2e", "select_by_id/connect_per_query", iterations, 1, [&]
+  {
+    pqxx::connection connection{connection_string(config)};
+    pqxx::work       worker{connection};
+    worker.exec("SELECT id, name, value, created FROM kdb_bench WHERE id='1'");
+    worker.commit();
+  });
+
+  for (const bool prepare : {false, true})
+  {
+    dbconfig cfg = config;
+    cfg.prepare  = prepare;
+    KDB kdb      = make_kdb(cfg);
+    measure("e2e", std::string{"select_by_id/pooled"} + (prepare ? "/prepared" : "/literal"), iterations, 1, [&]
+    {
+      kdb.select("kdb_bench", fields, CreateFilter("id", "1"));
+    });
+  }
+
+  // Result conversion from one pqxx::result of `rows` rows
+  {
+    pqxx::connection connection{connection_string(config)};
+    pqxx::work       worker{connection};
+    const auto       result = worker.exec("SELECT id, name, value, created FROM kdb_bench");
+    worker.commit();
+
+    const size_t conversions = std::max<size_t>(1, iterations / 100);
+    measure("e2e", "convert/QueryValues", conversions, rows, [&]
+    {
+      const auto values = to_values(result, fields);
+    });
+    measure("e2e", "convert/ResultSet", conversions, rows, [&]
+    {
+      const ResultSet set{result, fields};
+    });
+
+    // The same conversions split across 1 to N threads, the calling thread included
+    const size_t cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    for (size_t threads = 1; threads <= cores; threads = (threads == cores) ? cores + 1 : std::min(threads * 2, cores))
+    {
+      std::unique_ptr<thread_pool> helpers = (threads > 1) ? std::make_unique<thread_pool>(threads - 1) : nullptr;
+      const std::string            suffix  = "/" + std::to_string(threads) + "_threads";
+      measure("e2e", "convert_parallel/QueryValues" + suffix, conversions, rows, [&]
+      {
+        const auto values = to_values(result, fields, helpers.get());
+      });
+      measure("e2e", "convert_parallel/ResultSet" + suffix, conversions, rows, [&]
+      {
+        const ResultSet set{result, fields, false, helpers.get()};
+      });
+    }
+  }
+
+  KDB          kdb   = make_kdb(config);
+  const size_t scans = std::max<size_t>(1, iterations / 100);
+  measure("e2e", "select_all/QueryValues", scans, rows, [&]
+  {
+    kdb.select("kdb_bench", fields);
+  });
+  measure("e2e", "select_all/ResultSet", scans, rows, [&]
+  {
+    kdb.selectCompact("kdb_bench", fields);
+  });
+  measure("e2e", "select_all/stream", scans, rows, [&]
+  {
+    kdb.selectStream("kdb_bench", fields, {}, [](const ResultMap&) {});
+  });
+
+  // Inserts: one VALUES statement against COPY
+  const Values insert_rows = make_rows(rows);
+  {
+    dbconfig cfg       = config;
+    cfg.copy_threshold = 0;
+    KDB values_kdb     = make_kdb(cfg);
+    measure("e2e", "insert/values", scans, rows, [&]
+    {
+      values_kdb.insert("kdb_bench", {"name", "value"}, insert_rows);
+    });
+  }
+  measure("e2e", "insert/copy", scans, rows, [&]
+  {
+    kdb.bulk_insert("kdb_bench", {"name", "value"}, insert_rows);
+  });
+
+  // Per-call argument cost: arguments are copied at most once on the way to the statement builder
+  {
+    dbconfig          cfg     = config;
+    cfg.prepare               = true;
+    KDB               row_kdb = make_kdb(cfg);
+    const std::string table{"kdb_bench"};
+    const QueryFilter by_id = CreateFilter("id", "1");
+    check_copies("insert_row", iterations, [&](auto&&... args)
+    {
+      row_kdb.insert(std::forward<decltype(args)>(args)...);
+    }, table, Fields{"name", "value"}, Values{"row", "1"});
+    check_copies("select_compact", iterations, [&](auto&&... args)
+    {
+      row_kdb.selectCompact(std::forward<decltype(args)>(args)...);
+    }, table, fields, by_id);
+    check_copies("select_typed", iterations, [&](auto&&... args)
+    {
+      row_kdb.select<BenchRow>(std::forward<decltype(args)>(args)...);
+    }, table, by_id);
+    check_copies("select_stream", iterations, [&](auto&&... args)
+    {
+      row_kdb.selectStream(std::forward<decltype(args)>(args)..., [](const ResultMap&) {});
+    }, table, fields, by_id);
+  }
+
+  // Append-only rows: one insert each against the write-behind buffer, including its final flush
+  {
+    const size_t appends = std::min<size_t>(rows, 2000);
+    measure("e2e", "append/insert", 1, appends, [&]
+    {
+      for (size_t i = 0; i < appends; i++)
+        kdb.insert("kdb_bench", {"name", "value"}, {"append", std::to_string(i)});
+    });
+    WriteBuffer& buffer = kdb.buffer("kdb_bench", {"name", "value"});
+    measure("e2e", "append/buffered", 1, appends, [&]
+    {
+      for (size_t i = 0; i < appends; i++)
+        buffer.insert({"append", std::to_string(i)});
+      buffer.flush();
+    });
+  }
+
+  // Many small updates: one call each, one transaction, one pipelined batch, one bulk UPDATE
+  const size_t updates = std::min<size_t>(rows, 500);
+  measure("e2e", "update/sequential", 1, updates, [&]
+  {
+    for (size_t i = 1; i <= updates; i++)
+      kdb.update("kdb_bench", {"value"}, {"0"}, CreateFilter("id", std::to_string(i)));
+  });
+  measure("e2e", "update/transaction", 1, updates, [&]
+  {
+    kdb.transaction([&](Transaction& tx)
+    {
+      for (size_t i = 1; i <= updates; i++)
+        tx.update("kdb_bench", {"value"}, {"0"}, CreateFilter("id", std::to_string(i)));
+    });
+  });
+  measure("e2e", "update/batch", 1, updates, [&]
+  {
+    Batch batch;
+    for (size_t i = 1; i <= updates; i++)
+      batch.update("kdb_bench", {"value"}, {"0"}, CreateFilter("id", std::to_string(i)));
+    kdb.execute(batch);
+  });
+  measure("e2e", "update/bulk", 1, updates, [&]
+  {
+    Values values;
+    values.reserve(updates * 2);
+    for (size_t i = 1; i <= updates; i++)
+    {
+      values.emplace_back(std::to_string(i));
+      values.emplace_back("0");
+    }
+    kdb.bulk_update("kdb_bench", {"id"}, {"value"}, std::move(values));
+  });
+
+  // Purging rows by key: one remove per key against one bulk remove. Both refill the rows
+  // with COPY first, so compare the difference rather than the absolute numbers.
+  {
+    Values    purge_rows;
+    StringVec purge_keys;
+    for (size_t i = 1; i <= updates; i++)
+    {
+      purge_keys.emplace_back("-" + std::to_string(i));
+      purge_rows.emplace_back("purge");
+      purge_rows.emplace_back(purge_keys.back());
+    }
+    measure("e2e", "delete/sequential", 1, updates, [&]
+    {
+      kdb.bulk_insert("kdb_bench", {"name", "value"}, purge_rows);
+      for (const auto& key : purge_keys)
+        kdb.remove("kdb_bench", CreateFilter("value", key));
+    });
+    measure("e2e", "delete/bulk", 1, updates, [&]
+    {
+      kdb.bulk_insert("kdb_bench", {"name", "value"}, purge_rows);
+      kdb.bulk_remove("kdb_bench", "value", purge_keys);
+    });
+  }
+
+  // Concurrency: the same number of selects issued one after another or through the async pool
+  const size_t selects = 256;
+  measure("e2e", "select_by_id/sequential", 1, selects, [&]
+  {
+    for (size_t i = 0; i < selects; i++)
+      kdb.select("kdb_bench", fields, CreateFilter("id", std::to_string(i + 1)));
+  });
+  measure("e2e", "select_by_id/async", 1, selects, [&]
+  {
+    std::vector<std::future<QueryValues>> futures;
+    futures.reserve(selects);
+    for (size_t i = 0; i < selects; i++)
+      futures.push_back(kdb.selectAsync("kdb_bench", fields, CreateFilter("id", std::to_string(i + 1))));
+    for (auto& future : futures)
+      future.get();
+  });
+  measure("e2e", "select_by_id/multi_get", 1, selects, [&]
+  {
+    StringVec ids;
+    ids.reserve(selects);
+    for (size_t i = 0; i < selects; i++)
+      ids.push_back(std::to_string(i + 1));
+    kdb.multi_get("kdb_bench", fields, "id", std::move(ids));
+  });
+
+  // Stress: one KDB shared by 64 threads, four selects to every update, on a pool of 16,
+  // while another thread keeps swapping its observer. Needs a server, so it runs only
+  // by hand with --e2e (under -fsanitize=thread to look for races), never under ctest.
+  {
+    const size_t threads    = 64;
+    const size_t per_thread = std::max<size_t>(10, iterations / 100);
+    dbconfig     cfg        = config;
+    cfg.pool.max_size       = 16;
+    cfg.prepare             = true;
+    KDB                 shared = make_kdb(cfg);
+    std::atomic<size_t> errors{0};
+    measure("e2e", "shared/64_threads_mixed", 1, threads * per_thread, [&]
+    {
+      std::atomic<bool>        done{false};
+      std::thread              observing([&]
+      {
+        while (!done)
+        {
+          shared.observe(std::make_shared<QueryStats>());
+          shared.observe(nullptr);
+        }
+      });
+      std::vector<std::thread> workers;
+      workers.reserve(threads);
+      for (size_t t = 0; t < threads; t++)
+        workers.emplace_back([&, t]
+        {
+          for (size_t i = 0; i < per_thread; i++)
+            try
+            {
+              const std::string id = std::to_string((t * per_thread + i) % rows + 1);
+              if (i % 5 == 4)
+                shared.update("kdb_bench", {"value"}, {std::to_string(i)}, CreateFilter("id", id));
+              else
+                shared.select("kdb_bench", fields, CreateFilter("id", id));
+            }
+            catch (const std::exception& e)
+            {
+              if (!errors++)
+                std::cerr << "shared/64_threads_mixed: " << e.what() << '\n';
+            }
+        });
+      for (auto& worker : workers)
+        worker.join();
+      done = true;
+      observing.join();
+    });
+    if (errors)
+      throw std::runtime_error{std::to_string(errors) + " errors in shared/64_threads_mixed"};
+  }
+}
+//----------------------------------------------------
+std::string escape_json(const std::string& s)
+{
+  std::string out;
+  for (const char& c : s)
+    if (c == '"' || c == '\\')
+      out += std::string{'\\', c};
+    else
+      out += c;
+  return out;
+}
+//----------------------------------------------------
+void write_json(std::ostream& os)
+{
+  os << "{\n  \"revision\": \"" << KDB_BENCH_REVISION << "\",\n  \"results\": [\n";
+  for (size_t i = 0; i < g_results.size(); i++)
+  {
+    const auto& m = g_results[i];
+    os << "    {\"suite\": \""      << m.suite                 << "\", \"name\": \"" << escape_json(m.name) << '"'
+       << ", \"iterations\": "      << m.iterations
+       << ", \"items\": "           << m.items
+       << ", \"ns_per_op\": "       << std::setprecision(1)    << m.ns_per_op
+       << ", \"allocs_per_op\": "   << std::setprecision(2)    << m.allocs_per_op
+       << ", \"items_per_sec\": "   << std::setprecision(0)    << m.items * 1e9 / m.ns_per_op
+       << '}' << (i + 1 < g_results.size() ? "," : "") << '\n';
+  }
+  os << "  ]\n}\n";
+}
+//----------------------------------------------------
+void usage()
+{
+  std::cerr << "Usage: kdb_bench [--sql] [--e2e] [--iterations N] [--rows N] [--out results.json]\n"
+               "  --sql         statement generation microbenchmarks (default when --e2e is absent)\n"
+               "  --e2e         end-to-end benchmarks; connect with KDB_BENCH_HOST, KDB_BENCH_PORT,\n"
+               "                KDB_BENCH_USER, KDB_BENCH_PASSWORD and KDB_BENCH_NAME\n"
+               "  --iterations  iterations per microbenchmark (default 100000, e2e uses 1/100th)\n"
+               "  --rows        rows in the end-to-end table (default 100000)\n"
+               "  --out         write JSON results to a file instead of stdout\n";
+}
+} // ns
+
+int main(int argc, char** argv)
+{
+  bool        sql{false};
+  bool        e2e{false};
+  size_t      iterations{100000};
+  size_t      rows{100000};
+  std::string out;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg = argv[i];
+    if      (arg == "--sql")                          sql        = true;
+    else if (arg == "--e2e")                          e2e        = true;
+    else if (arg == "--iterations" && i + 1 < argc)   iterations = std::stoul(argv[++i]);
+    else if (arg == "--rows"       && i + 1 < argc)   rows       = std::stoul(argv[++i]);
+    else if (arg == "--out"        && i + 1 < argc)   out        = argv[++i];
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  if (!sql && !e2e)
+    sql = true;
+
+  try
+  {
+    if (sql)
+      run_sql(iterations);
+    if (e2e)
+      run_e2e(rows, std::max<size_t>(100, iterations / 100));
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "kdb_bench: " << e.what() << std::endl;
+    return 1;
+  }
+
+  if (out.empty())
+    write_json(std::cout);
+  else
+  {
+    std::ofstream file{out};
+    write_json(file);
+  }
+
+  return 0;
+}
@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+# Runs kdb_bench against a throwaway PostgreSQL cluster and writes JSON results.
+#
+#   bench/run.sh <path/to/kdb_bench> [results.json] [extra kdb_bench args...]
+#
+# initdb, pg_ctl and createdb must be on PATH (or under `pg_config --bindir`).
+set -euo pipefail
+
+BENCH=${1:?path to kdb_bench}
+OUT=${2:-bench_results.json}
+shift $(( $# > 1 ? 2 : 1 ))
+
+PGBIN=$(pg_config --bindir 2>/dev/null || true)
+[ -n "$PGBIN" ] && export PATH="$PGBIN:$PATH"
+
+PORT=${KDB_BENCH_PORT:-54329}
+DATA=$(mktemp -d)
+trap 'pg_ctl -D "$DATA" -m immediate stop >/dev/null 2>&1 || true; rm -rf "$DATA"' EXIT
+
+initdb -D "$DATA" -U kdb --auth=trust >/dev/null
+pg_ctl -D "$DATA" -l "$DATA/server.log" -w \
+       -o "-p $PORT -k $DATA -c listen_addresses=127.0.0.1" start >/dev/null
+createdb -h 127.0.0.1 -p "$PORT" -U kdb kdb_bench
+
+KDB_BENCH_HOST=127.0.0.1    \
+KDB_BENCH_PORT="$PORT"      \
+KDB_BENCH_USER=kdb          \
+KDB_BENCH_PASSWORD=kdb      \
+KDB_BENCH_NAME=kdb_bench    \
+  "$BENCH" --sql --e2e --out "$OUT" "$@"
+
+echo "Results written to $OUT"
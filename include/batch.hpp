@@ -0,0 +1,79 @@
+#pragma once
+
+#include "db_structs.hpp"
+
+namespace kdb
+{
+/**
+ * Queues statements to be sent together by KDB::execute. Each call returns the index
+ * of its result in the vector execute() returns.
+ */
+class Batch {
+public:
+  size_t select(std::string table, Fields fields, QueryFilter filter = {})
+  {
+    return add(DatabaseQuery{
+      .table  = std::move(table),
+      .fields = std::move(fields),
+      .type   = QueryType::SELECT,
+      .values = {},
+      .filter = std::move(filter)});
+  }
+
+  size_t insert(std::string table, Fields fields, Values values)
+  {
+    return add(DatabaseQuery{
+      .table  = std::move(table),
+      .fields = std::move(fields),
+      .type   = QueryType::INSERT,
+      .values = std::move(values),
+      .filter = QueryFilter{}});
+  }
+
+  size_t insert(std::string table, Fields fields, Values values, std::string returning)
+  {
+    return add(InsertReturnQuery{
+      .table     = std::move(table),
+      .fields    = std::move(fields),
+      .type      = QueryType::INSERT,
+      .values    = std::move(values),
+      .returning = std::move(returning)});
+  }
+
+  size_t update(std::string table, Fields fields, Values values, QueryFilter filter,
+                std::string returning = "id")
+  {
+    return add(UpdateReturnQuery{
+      .table     = std::move(table),
+      .fields    = std::move(fields),
+      .type      = QueryType::UPDATE,
+      .values    = std::move(values),
+      .filter    = std::move(filter),
+      .returning = std::move(returning)});
+  }
+
+  size_t remove(std::string table, QueryFilter filter)
+  {
+    return add(DatabaseQuery{
+      .table  = std::move(table),
+      .fields = {},
+      .type   = QueryType::DELETE,
+      .values = {},
+      .filter = std::move(filter)});
+  }
+
+  size_t add(BatchQuery query)
+  {
+    m_queries.emplace_back(std::move(query));
+    return m_queries.size() - 1;
+  }
+
+  const std::vector<BatchQuery>& queries() const { return m_queries;         }
+  size_t                         size()    const { return m_queries.size();  }
+  bool                           empty()   const { return m_queries.empty(); }
+  void                           clear()         { m_queries.clear();        }
+
+private:
+  std::vector<BatchQuery> m_queries;
+};
+} // ns kdb
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <pqxx/pqxx>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace kdb
+{
+/**
+ * Decoding of values fetched in PostgreSQL's binary wire format (result format 1).
+ * Fixed-width columns are read straight from network byte order; text-like columns
+ * arrive as their raw bytes. Other types arrive in their binary send format; decoding
+ * them raises a conversion_error, though ResultSet::value() still hands out the bytes.
+ */
+namespace pg_type
+{
+inline constexpr pqxx::oid BOOL        = 16;
+inline constexpr pqxx::oid BYTEA       = 17;
+inline constexpr pqxx::oid CHAR        = 18;
+inline constexpr pqxx::oid NAME        = 19;
+inline constexpr pqxx::oid INT8        = 20;
+inline constexpr pqxx::oid INT2        = 21;
+inline constexpr pqxx::oid INT4        = 23;
+inline constexpr pqxx::oid TEXT        = 25;
+inline constexpr pqxx::oid JSON        = 114;
+inline constexpr pqxx::oid XML         = 142;
+inline constexpr pqxx::oid FLOAT4      = 700;
+inline constexpr pqxx::oid FLOAT8      = 701;
+inline constexpr pqxx::oid UNKNOWN     = 705;
+inline constexpr pqxx::oid BPCHAR      = 1042;
+inline constexpr pqxx::oid VARCHAR     = 1043;
+inline constexpr pqxx::oid TIMESTAMP   = 1114;
+inline constexpr pqxx::oid TIMESTAMPTZ = 1184;
+inline constexpr pqxx::oid JSONB       = 3802;
+} // ns pg_type
+
+using timestamp = std::chrono::system_clock::time_point;
+
+template <typename T>
+struct is_optional : std::false_type {};
+
+template <typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+struct dependent_false : std::false_type {};
+//----------------------------------------------------
+inline uint64_t read_network(std::string_view bytes)
+{
+  uint64_t value{};
+  for (const char c : bytes)
+    value = (value << 8) | static_cast<uint8_t>(c);
+  return value;
+}
+//----------------------------------------------------
+inline int64_t read_integer(std::string_view bytes)
+{
+  switch (bytes.size())
+  {
+    case 2:  return static_cast<int16_t>(read_network(bytes));
+    case 4:  return static_cast<int32_t>(read_network(bytes));
+    case 8:  return static_cast<int64_t>(read_network(bytes));
+    default: throw pqxx::conversion_error{"Unexpected binary integer width " + std::to_string(bytes.size())};
+  }
+}
+//----------------------------------------------------
+inline double read_float(std::string_view bytes, pqxx::oid type)
+{
+  if (type == pg_type::FLOAT4 && bytes.size() == 4)
+  {
+    const uint32_t bits = static_cast<uint32_t>(read_network(bytes));
+    float          value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  if (type == pg_type::FLOAT8 && bytes.size() == 8)
+  {
+    const uint64_t bits = read_network(bytes);
+    double         value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  throw pqxx::conversion_error{"Column of type " + std::to_string(type) + " is not a binary float"};
+}
+//----------------------------------------------------
+/**
+ * The timestamp `seconds` + `micros` (0 to 999999) after the Unix epoch, or a
+ * conversion_error when system_clock cannot represent it (about +-292 years around 1970
+ * with nanosecond ticks).
+ */
+inline timestamp unix_timestamp(int64_t seconds, int64_t micros)
+{
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  static constexpr int64_t MAX_SECONDS = duration_cast<microseconds>(timestamp::duration::max()).count() / 1000000 - 1;
+  static constexpr int64_t MIN_SECONDS = duration_cast<microseconds>(timestamp::duration::min()).count() / 1000000 + 1;
+  if (seconds > MAX_SECONDS || seconds < MIN_SECONDS)
+    throw pqxx::conversion_error{"Timestamp out of range for kdb::timestamp"};
+  return timestamp{duration_cast<timestamp::duration>(microseconds{seconds * 1000000 + micros})};
+}
+//----------------------------------------------------
+inline bool is_integer(pqxx::oid type)
+{
+  return type == pg_type::INT2 || type == pg_type::INT4 || type == pg_type::INT8;
+}
+//----------------------------------------------------
+inline bool is_text(pqxx::oid type)
+{
+  switch (type)
+  {
+    case pg_type::TEXT:  case pg_type::VARCHAR: case pg_type::BPCHAR:  case pg_type::CHAR:
+    case pg_type::NAME:  case pg_type::JSON:    case pg_type::XML:     case pg_type::UNKNOWN:
+      return true;
+    default:
+      return false;
+  }
+}
+//----------------------------------------------------
+/**
+ * Renders a binary value as the text PostgreSQL would have sent. Types without a
+ * rendering here (numeric, date, uuid, arrays, ...) raise a conversion_error rather than
+ * passing their send format off as text; select those as ::text.
+ */
+inline std::string binary_text(std::string_view bytes, pqxx::oid type)
+{
+  if (is_text(type))
+    return std::string{bytes};
+  if (is_integer(type))
+    return std::to_string(read_integer(bytes));
+  if (type == pg_type::FLOAT4 || type == pg_type::FLOAT8)
+    return pqxx::to_string(read_float(bytes, type));
+  if (type == pg_type::BOOL)
+    return (!bytes.empty() && bytes.front()) ? "t" : "f";
+  if (type == pg_type::JSONB && !bytes.empty() && bytes.front() == 1)
+    return std::string{bytes.substr(1)}; // version 1 is a format byte then the JSON text
+  if (type == pg_type::BYTEA)
+  {
+    static const char* hex = "0123456789abcdef";
+    std::string        text{"\\x"};
+    text.reserve(2 + bytes.size() * 2);
+    for (const char c : bytes)
+    {
+      text.push_back(hex[static_cast<uint8_t>(c) >> 4]);
+      text.push_back(hex[static_cast<uint8_t>(c) & 0xF]);
+    }
+    return text;
+  }
+  throw pqxx::conversion_error{"Column of type " + std::to_string(type) +
+                               " cannot be read as text from a binary result; select it as ::text"};
+}
+//----------------------------------------------------
+template <typename T>
+T decode_binary(std::string_view bytes, bool null, pqxx::oid type)
+{
+  if constexpr (is_optional<T>::value)
+  {
+    if (null)
+      return std::nullopt;
+    return decode_binary<typename T::value_type>(bytes, false, type);
+  }
+  else
+  {
+    if (null)
+      throw pqxx::conversion_error{"Cannot convert NULL to a non-optional member"};
+
+    if constexpr (std::is_same_v<T, bool>)
+    {
+      if (type != pg_type::BOOL)
+        throw pqxx::conversion_error{"Column of type " + std::to_string(type) + " is not a boolean"};
+      return !bytes.empty() && bytes.front();
+    }
+    else
+    if constexpr (std::is_integral_v<T>)
+    {
+      if (!is_integer(type))
+        throw pqxx::conversion_error{"Column of type " + std::to_string(type) + " is not an integer"};
+      return static_cast<T>(read_integer(bytes));
+    }
+    else
+    if constexpr (std::is_floating_point_v<T>)
+      return static_cast<T>(is_integer(type) ? read_integer(bytes) : read_float(bytes, type));
+    else
+    if constexpr (std::is_same_v<T, timestamp>)
+    {
+      if (type != pg_type::TIMESTAMP && type != pg_type::TIMESTAMPTZ)
+        throw pqxx::conversion_error{"Column of type " + std::to_string(type) + " is not a timestamp"};
+      static constexpr int64_t PG_EPOCH = 946684800; // 2000-01-01 in Unix seconds
+      const int64_t micros = read_integer(bytes);    // since PG_EPOCH
+      if (micros == std::numeric_limits<int64_t>::max())
+        return timestamp::max(); // infinity
+      if (micros == std::numeric_limits<int64_t>::min())
+        return timestamp::min(); // -infinity
+
+      int64_t seconds = micros / 1000000;
+      int64_t rest    = micros % 1000000;
+      if (rest < 0)
+      {
+        seconds--;
+        rest += 1000000;
+      }
+      return unix_timestamp(seconds + PG_EPOCH, rest);
+    }
+    else
+    if constexpr (std::is_same_v<T, std::string>)
+      return binary_text(bytes, type);
+    else
+      static_assert(dependent_false<T>::value, "No binary decoding for this member type");
+  }
+}
+//----------------------------------------------------
+// Days since 1970-01-01 of a proleptic Gregorian date
+inline int64_t days_from_civil(int64_t year, unsigned month, unsigned day)
+{
+  year -= month <= 2;
+  const int64_t  era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(year - era * 400);
+  const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+//----------------------------------------------------
+/**
+ * Reads a timestamp or timestamptz in the text form of the default ISO DateStyle,
+ * "YYYY-MM-DD HH:MM:SS[.ffffff][+HH[:MM[:SS]]]". Without an offset the value is taken
+ * as UTC, as its binary form is.
+ */
+inline timestamp parse_timestamp(std::string_view text)
+{
+  if (text == "infinity")
+    return timestamp::max();
+  if (text == "-infinity")
+    return timestamp::min();
+
+  size_t pos{0};
+  const auto fail = [text]
+  {
+    return pqxx::conversion_error{"Could not parse timestamp \"" + std::string{text} + '"'};
+  };
+  const auto number = [&](size_t min_digits, size_t max_digits)
+  {
+    int64_t value{};
+    size_t  digits{};
+    while (pos < text.size() && digits < max_digits && text[pos] >= '0' && text[pos] <= '9')
+    {
+      value = value * 10 + (text[pos++] - '0');
+      digits++;
+    }
+    if (digits < min_digits)
+      throw fail();
+    return value;
+  };
+  const auto expect = [&](char c)
+  {
+    if (pos >= text.size() || text[pos] != c)
+      throw fail();
+    pos++;
+  };
+
+  const int64_t year   = number(4, 9);  expect('-');
+  const int64_t month  = number(2, 2);  expect('-');
+  const int64_t day    = number(2, 2);  expect(' ');
+  const int64_t hour   = number(2, 2);  expect(':');
+  const int64_t minute = number(2, 2);  expect(':');
+  const int64_t second = number(2, 2);
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 24 || minute > 59 || second > 60)
+    throw fail();
+
+  int64_t micros{0};
+  if (pos < text.size() && text[pos] == '.')
+  {
+    pos++;
+    const size_t start = pos;
+    micros = number(1, 6);
+    for (size_t digits = pos - start; digits < 6; digits++)
+      micros *= 10;
+  }
+
+  int64_t offset{0};
+  if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+  {
+    const int64_t sign = (text[pos++] == '-') ? -1 : 1;
+    offset = number(2, 2) * 3600;
+    if (pos < text.size() && text[pos] == ':')
+    {
+      pos++;
+      offset += number(2, 2) * 60;
+      if (pos < text.size() && text[pos] == ':')
+      {
+        pos++;
+        offset += number(2, 2);
+      }
+    }
+    offset *= sign;
+  }
+  if (pos != text.size())
+    throw fail(); // e.g. " BC" or a non-ISO DateStyle
+
+  const int64_t seconds = days_from_civil(year, static_cast<unsigned>(month), static_cast<unsigned>(day)) * 86400 +
+                          hour * 3600 + minute * 60 + second - offset;
+  return unix_timestamp(seconds, micros);
+}
+//----------------------------------------------------
+template <typename T>
+T decode_text(std::string_view text, bool null)
+{
+  if constexpr (is_optional<T>::value)
+  {
+    if (null)
+      return std::nullopt;
+    return decode_text<typename T::value_type>(text, false);
+  }
+  else
+  {
+    if (null)
+      throw pqxx::conversion_error{"Cannot convert NULL to a non-optional member"};
+
+    if constexpr (std::is_same_v<T, timestamp>)
+      return parse_timestamp(text);
+    else
+      return pqxx::from_string<T>(text);
+  }
+}
+} // ns kdb
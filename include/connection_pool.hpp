@@ -0,0 +1,77 @@
+#pragma once
+
+#include "db_structs.hpp"
+#include <pqxx/pqxx>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace kdb
+{
+/**
+ * Connections shared by every thread using one db_cxn. A thread gets back the idle
+ * connection it used last when there is one, so it keeps its prepared statements and a
+ * warm backend without one connection per thread.
+ *
+ * min_size connections are opened by the constructor, which throws when the server is
+ * unreachable. Connections above that are closed once idle for idle_timeout, checked on
+ * every acquire and release.
+ */
+class connection_pool {
+public:
+  using clock = std::chrono::steady_clock;
+
+  using statements = std::unordered_map<std::string, std::string>; // SQL -> prepared name
+
+  struct entry
+  {
+    std::unique_ptr<pqxx::connection> connection;
+    clock::time_point                 last_used;
+    statements                        prepared;
+    std::thread::id                   owner;     // thread that last leased it
+  };
+//----------------------------------------------------
+  class lease {
+  public:
+    lease(connection_pool* pool, entry e);
+    lease(lease&& l);
+    lease(const lease& l) = delete;
+    ~lease();
+
+    pqxx::connection& operator*()  const { return *m_entry.connection; }
+    pqxx::connection* operator->() const { return  m_entry.connection.get(); }
+    statements&       prepared()         { return  m_entry.prepared;         }
+
+  private:
+    connection_pool* m_pool;
+    entry            m_entry;
+  };
+//----------------------------------------------------
+  connection_pool(std::string connection_string, poolconfig config);
+  connection_pool(const connection_pool& p) = delete;
+  ~connection_pool() = default;
+
+  lease  acquire();
+  size_t size() const;
+  size_t idle() const;
+
+private:
+  void   release(entry e);
+  entry  open();
+  bool   healthy(entry& e) const;
+  std::vector<entry> evict(clock::time_point now);
+  entry  take_idle();
+
+  std::string             m_connection_string;
+  poolconfig              m_config;
+  std::deque<entry>       m_idle;
+  size_t                  m_total{0};
+  mutable std::mutex      m_mutex;
+  std::condition_variable m_available;
+};
+} // ns kdb
@@ -2,16 +2,40 @@
 
 #include "db_structs.hpp"
 #include "database_interface.hpp"
+#include "connection_pool.hpp"
+#include "helpers.hpp"
+#include "observer.hpp"
+#include "result_cache.hpp"
+#include "result_set.hpp"
+#include "results.hpp"
+#include "row_traits.hpp"
+#include "thread_pool.hpp"
+#include "transaction.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <type_traits>
 #include <pqxx/pqxx>
 
 namespace kdb
 {
+class reactor;
+
 class db_cxn : public DatabaseInterface {
 public:
 // constructor
   db_cxn() {}
   db_cxn(db_cxn&& d)
-  : m_config(std::move(d.m_config)) {}
+  : m_config(std::move(d.m_config)),
+    m_pool(std::move(d.m_pool)),
+    m_observer(std::move(d.m_observer)),
+    m_cache(std::move(d.m_cache)),
+    m_column_types(std::move(d.m_column_types)),
+    m_converters(std::move(d.m_converters)) {}
   db_cxn(const db_cxn& d) = delete;
   virtual ~db_cxn() final {}
 
@@ -20,21 +44,320 @@ public:
   std::string         query(InsertReturnQuery query);
   std::string         query(UpdateReturnQuery query);
   virtual QueryResult query(DatabaseQuery query) final;
+  size_t              bulk_insert(DatabaseQuery query);
+  QueryValues         bulk_update(const BulkUpdateQuery& query);
+  template <typename T>
+  StringVec           bulk_delete(const BulkDeleteQuery<T>& query);
+  template <typename T>
+  KeyedValues         multi_get(const MultiGetQuery<T>& query, thread_pool* workers = nullptr);
+  std::vector<BatchResult> execute(const std::vector<BatchQuery>& queries);
+  std::unique_ptr<Transaction> begin();
+  std::unique_ptr<reactor>     open_reactor();
+  template <typename T>
+  size_t              stream(const T& query, const RowCallback& callback);
+  template <typename T>
+  pqxx::result        select(const T& query);
+  template <typename T>
+  ResultSet           fetch(const T& query);
+  template <typename Row, typename T>
+  std::vector<Row>    decode(const T& query);
   std::string         name();
+  bool                binary() const { return m_config.binary; }
+  void                set_observer(std::shared_ptr<QueryObserver> observer);
+  void                invalidate(const std::string& table);
+  CacheStats          cache_stats() const;
   virtual bool        set_config(dbconfig config) final;
 
 private:
+  friend class Transaction;
+
   std::string         connection_string();
-  pqxx::result        do_insert(DatabaseQuery query);
-  pqxx::result        do_insert(InsertReturnQuery query, std::string returning);
+  connection_pool::lease connection();
+  ColumnTypes         column_types(connection_pool::lease& cxn, const std::string& table);
+  thread_pool*        converters(size_t rows) const;
+  pqxx::result        do_insert(const DatabaseQuery& query);
+  pqxx::result        do_insert(const InsertReturnQuery& query, const std::string& returning);
+  size_t              do_copy(const DatabaseQuery& query);
   template <typename T>
-  pqxx::result        do_select(T query);
+  pqxx::result        do_select(const T& query);
   template <typename T>
-  pqxx::result        do_delete(T query);
-  pqxx::result        do_update(UpdateReturnQuery query, std::string returning);
+  pqxx::result        do_delete(const T& query);
+  pqxx::result        do_update(const UpdateReturnQuery& query, const std::string& returning);
+  pqxx::result        exec(connection_pool::lease& cxn, pqxx::work& worker, const std::string& sql,
+                           const Binder& binder);
+  pqxx::result        exec_binary(pqxx::work& worker, const std::string& sql, const Binder& binder);
+  template <typename T>
+  QueryResult         cached(const T& query);
+  template <typename F>
+  pqxx::result        run(QueryType type, const std::string& table, F&& build, bool binary = false);
+  template <typename F>
+  auto                timed(QueryPhase phase, QueryType type, const std::string& table, F&& fn)
+                        -> std::invoke_result_t<F>;
 
-  dbconfig     m_config;
-  std::string  m_db_name;
+  dbconfig                                     m_config;
+  std::string                                  m_db_name;
+  std::unique_ptr<connection_pool>             m_pool;
+  std::shared_ptr<QueryObserver>               m_observer; // only through std::atomic_load/store
+  std::unique_ptr<ResultCache>                 m_cache;
+  std::unordered_map<std::string, ColumnTypes> m_column_types; // per table, looked up once
+  std::mutex                                   m_column_types_mutex;
+  std::unique_ptr<thread_pool>                 m_converters;   // helpers for convert_threads
 
 };
-} // ns kdb
\ No newline at end of file
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░░ Templates ░░░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+// Defined here so any query shape and filter composition instantiates on use.
+
+/**
+ * Times fn as one phase of a statement and reports it to the observer. Without an
+ * observer this is a plain call.
+ */
+template <typename F>
+auto db_cxn::timed(QueryPhase phase, QueryType type, const std::string& table, F&& fn) -> std::invoke_result_t<F>
+{
+  using R = std::invoke_result_t<F>;
+  const auto observer = std::atomic_load(&m_observer); // set_observer() may swap it meanwhile
+  if (!observer)
+    return fn();
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto event = [&](size_t rows, size_t bytes)
+  {
+    observer->on_phase(QueryEvent{phase, type, table,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start), rows, bytes});
+  };
+
+  if constexpr (std::is_void_v<R>)
+  {
+    fn();
+    event(0, 0);
+  }
+  else
+  {
+    R      result = fn();
+    size_t rows{};
+    size_t bytes{};
+    if constexpr (std::is_same_v<R, pqxx::result>)
+    {
+      rows = result.size();
+      for (const auto& row : result)
+        for (const auto& field : row)
+          bytes += field.size();
+    }
+    else
+    if constexpr (std::is_same_v<R, QueryValues>)
+      rows = result.size();
+
+    event(rows, bytes);
+    return result;
+  }
+}
+
+template <typename F>
+pqxx::result db_cxn::run(QueryType type, const std::string& table, F&& build, bool binary)
+{
+  auto              cxn         = timed(QueryPhase::CONNECT, type, table, [this] { return connection(); });
+  pqxx::work        worker(*cxn);
+  Binder            binder{m_config.prepare};
+  const std::string sql         = timed(QueryPhase::BUILD,   type, table, [&] { return build(binder); });
+  pqxx::result      pqxx_result = timed(QueryPhase::EXECUTE, type, table, [&]
+  {
+    return (binary) ? exec_binary(worker, sql, binder) : exec(cxn, worker, sql, binder);
+  });
+  timed(QueryPhase::COMMIT, type, table, [&] { worker.commit(); });
+
+  return pqxx_result;
+}
+
+template <typename T>
+pqxx::result db_cxn::do_select(const T& query)
+{
+  return run(QueryType::SELECT, query.table, [&](Binder& binder) { return select_statement(query, binder); });
+}
+
+template <typename T>
+pqxx::result db_cxn::do_delete(const T& query)
+{
+  return run(QueryType::DELETE, query.table, [&](Binder& binder) { return delete_statement(query, binder); });
+}
+
+/**
+ * Serves a select from the result cache when it is enabled for every table the query
+ * reads, keyed by the statement with its values inlined.
+ */
+template <typename T>
+QueryResult db_cxn::cached(const T& query)
+{
+  const auto fetch = [this, &query]
+  {
+    const pqxx::result pqxx_result = do_select(query);
+    return QueryResult{.table = query.table, .values = timed(QueryPhase::CONVERT, QueryType::SELECT, query.table,
+      [&] { return to_values(pqxx_result, result_fields(query), converters(pqxx_result.size())); })};
+  };
+
+  if (!m_cache)
+    return fetch();
+
+  const auto tables = query_tables(query);
+  if (!m_cache->cacheable(tables))
+    return fetch();
+
+  Binder      binder{};
+  std::string key = select_statement(query, binder);
+  if (auto values = m_cache->get(key))
+    return QueryResult{.table = query.table, .values = std::move(*values)};
+
+  const uint64_t epoch  = m_cache->epoch();
+  QueryResult    result = fetch();
+  m_cache->put(std::move(key), tables, result.values, epoch);
+  return result;
+}
+
+template <typename T>
+QueryResult db_cxn::query(T query)
+{
+  return cached(query);
+}
+
+template <typename T>
+pqxx::result db_cxn::select(const T& query)
+{
+  if (!m_config.binary)
+    return do_select(query);
+
+  return run(QueryType::SELECT, query.table, [&](Binder& binder) { return select_statement(query, binder); }, true);
+}
+
+template <typename T>
+ResultSet db_cxn::fetch(const T& query)
+{
+  const pqxx::result pqxx_result = select(query);
+  return timed(QueryPhase::CONVERT, QueryType::SELECT, query.table, [&]
+  {
+    return ResultSet{pqxx_result, result_fields(query), m_config.binary, converters(pqxx_result.size())};
+  });
+}
+
+template <typename Row, typename T>
+std::vector<Row> db_cxn::decode(const T& query)
+{
+  const pqxx::result pqxx_result = select(query);
+  return timed(QueryPhase::CONVERT, QueryType::SELECT, query.table, [&]
+  {
+    return decode_rows<Row>(pqxx_result, m_config.binary, converters(pqxx_result.size()));
+  });
+}
+
+/**
+ * Rows are read one at a time from COPY (...) TO STDOUT and handed to the callback in
+ * a single ResultMap whose values are overwritten for each row, so memory use does not
+ * grow with the size of the result. COPY takes no parameters, so values are inlined.
+ */
+template <typename T>
+size_t db_cxn::stream(const T& query, const RowCallback& callback)
+{
+  Binder                    binder{};
+  auto                      cxn = connection();
+  pqxx::work                worker(*cxn);
+  auto                      stream = pqxx::stream_from::query(worker, select_statement(query, binder));
+  ResultMap                 values;
+  std::vector<std::string*> slots;
+  size_t                    count{};
+
+  for (const auto& field : query.fields)
+    slots.push_back(&values[field]);
+
+  while (const auto row = stream.read_row())
+  {
+    for (size_t i = 0; i < row->size() && i < slots.size(); i++)
+    {
+      const auto& value = (*row)[i];
+      if (value.data())
+        slots[i]->assign(value.data(), value.size());
+      else
+        slots[i]->clear();
+    }
+    callback(values);
+    count++;
+  }
+
+  stream.complete();
+  worker.commit();
+
+  return count;
+}
+
+/**
+ * Keys are deleted chunk_size at a time, each chunk bound as one array parameter, all in
+ * one transaction. Returns the keys of the rows that were deleted.
+ */
+template <typename T>
+StringVec db_cxn::bulk_delete(const BulkDeleteQuery<T>& query)
+{
+  if (query.keys.empty())
+    return {};
+
+  const size_t keys  = query.keys.size();
+  const size_t chunk = (m_config.chunk_size) ? m_config.chunk_size : keys;
+  const auto   type  = QueryType::DELETE;
+  auto         cxn   = timed(QueryPhase::CONNECT, type, query.table, [this] { return connection(); });
+  pqxx::work   worker(*cxn);
+  StringVec    deleted;
+  deleted.reserve(keys);
+
+  for (size_t first = 0; first < keys; first += chunk)
+  {
+    Binder             binder{m_config.prepare};
+    const std::string  sql         = bulk_delete_statement(query, first, std::min(chunk, keys - first), binder);
+    const pqxx::result pqxx_result = timed(QueryPhase::EXECUTE, type, query.table,
+      [&] { return exec(cxn, worker, sql, binder); });
+    for (const auto& row : pqxx_result)
+      deleted.emplace_back(row[0].c_str());
+  }
+
+  timed(QueryPhase::COMMIT, type, query.table, [&] { worker.commit(); });
+  invalidate(query.table);
+  return deleted;
+}
+
+/**
+ * Keys are looked up chunk_size at a time, each chunk one select with its keys bound as
+ * an array parameter. Given `workers`, chunks run concurrently through for_chunks, each
+ * on its own pooled connection, so it is safe to call from a worker of the same pool.
+ *
+ * `key` is selected even when missing from `fields`, and rows come back grouped by its
+ * value. Keys without rows are absent. Results bypass the cache.
+ */
+template <typename T>
+KeyedValues db_cxn::multi_get(const MultiGetQuery<T>& query, thread_pool* workers)
+{
+  KeyedValues grouped;
+  if (query.keys.empty())
+    return grouped;
+
+  Fields fields = query.fields;
+  if (std::find(fields.begin(), fields.end(), query.key) == fields.end())
+    fields.push_back(query.key);
+
+  const size_t             keys  = query.keys.size();
+  const size_t             chunk = (m_config.chunk_size) ? m_config.chunk_size : keys;
+  std::vector<QueryValues> results((keys + chunk - 1) / chunk);
+
+  for_chunks(workers, keys, chunk, [&](size_t first, size_t last)
+  {
+    const pqxx::result pqxx_result = run(QueryType::SELECT, query.table, [&](Binder& binder)
+    {
+      return multi_get_statement(query, fields, first, last - first, binder);
+    });
+    results[first / chunk] = timed(QueryPhase::CONVERT, QueryType::SELECT, query.table,
+      [&] { return to_values(pqxx_result, fields); });
+  }, std::max<size_t>(m_config.pool.max_size, 1) - 1);
+
+  grouped.reserve(keys);
+  for (auto& values : results)
+    for (auto& row : values)
+      grouped[row.at(query.key)].push_back(std::move(row));
+  return grouped;
+}
+} // ns kdb
@@ -1,10 +1,15 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <functional>
 #include <string>
 #include <utility>
 #include <vector>
 #include <variant>
 #include <map>
+#include <unordered_map>
+#include <stdexcept>
 
 namespace kdb
 {
@@ -26,6 +31,7 @@ using Values                       = std::vector<std::string>;
 using QueryValue                   = std::pair<std::string, std::string>;
 using ResultMap                    = std::map<std::string, std::string>;
 using QueryValues                  = std::vector<ResultMap>;
+using RowCallback                  = std::function<void(const ResultMap&)>;
 
 struct identification
 {
@@ -39,11 +45,54 @@ struct identification
   }
 };
 
+struct poolconfig
+{
+  size_t                    min_size        {1};      // connections opened up front and kept open
+  size_t                    max_size        {8};      // callers block when all are leased
+  std::chrono::milliseconds idle_timeout    {60000};  // idle connections above min_size are closed after this
+  std::chrono::milliseconds health_check    {5000};   // idle connections older than this are pinged on acquire
+  std::chrono::milliseconds acquire_timeout {10000};  // how long to wait for a free connection
+};
+
+struct cacheconfig
+{
+  size_t                                                     max_bytes {0};     // 0 disables the result cache
+  std::chrono::milliseconds                                  ttl       {1000};  // lifetime of a cached select
+  std::unordered_map<std::string, std::chrono::milliseconds> tables    {};      // per-table TTL; 0 never caches
+};
+
+enum class BufferOverflow
+{
+  BLOCK = 0, // wait for the flusher to make room
+  DROP  = 1, // discard the row and count it
+  THROW = 2  // throw std::length_error
+};
+
+struct bufferconfig
+{
+  size_t                    max_rows  {1000};     // flush once this many rows are queued
+  size_t                    max_bytes {1 << 20};  // or once their values reach this size
+  std::chrono::milliseconds interval  {100};      // or after this long, whichever comes first
+  size_t                    capacity  {100000};   // rows held before the overflow policy applies
+  BufferOverflow            overflow  {BufferOverflow::BLOCK};
+};
+
 struct dbconfig
 {
   identification credentials;
-  std::string    address    {"127.0.0.1"};
-  std::string    port       {"5432"};
+  std::string    address        {"127.0.0.1"};
+  std::string    port           {"5432"};
+  poolconfig     pool           {};
+  bool           prepare        {false}; // send values as $n parameters of per-connection prepared statements
+  size_t         statements     {256};   // prepared statements kept per connection
+  size_t         copy_threshold {1000};  // multi-row inserts above this many rows use COPY (0 disables)
+  size_t         async_workers  {4};     // threads serving the KDB *Async calls, started on first use
+  size_t         chunk_size     {1000};  // rows or keys per statement for bulk updates, deletes and multi-gets
+  bool           binary         {false}; // typed and columnar selects fetch results in binary format
+  size_t         convert_threads{1};     // threads converting one large result, the caller included
+  size_t         convert_rows   {50000}; // results above this many rows are converted in parallel
+  size_t         reactor_size   {4};     // connections of each reactor from KDB::openReactor()
+  cacheconfig    cache          {};
 
   bool validate() const
   {
@@ -52,7 +101,7 @@ struct dbconfig
 };
 
 
-static std::string DoubleSingleQuotes(const std::string& s)
+inline std::string DoubleSingleQuotes(const std::string& s)
 {
   std::string o;
   for (const char& c : s)
@@ -93,7 +142,7 @@ void Add(Ts&&... args)
     const auto& key   = v[i    ];
     const auto& value = v[i + 1];
     if (value.empty())  continue;
-    m_filters.emplace_back(FilterPair{key, DoubleSingleQuotes(value)});
+    m_filters.emplace_back(FilterPair{key, value});
   }
 }
 
@@ -160,7 +209,7 @@ struct OrderFilter
 {
 std::string field;
 std::string order;
-bool has_value()
+bool has_value() const
 {
   return (!field.empty());
 }
@@ -169,9 +218,10 @@ bool has_value()
 struct LimitFilter
 {
 std::string count;
-bool has_value()
+std::string offset;
+bool has_value() const
 {
-  return (!count.empty());
+  return (!count.empty() || !offset.empty());
 }
 };
 
@@ -187,6 +237,8 @@ std::vector<std::string> fields;
 QueryType type;
 std::vector<std::string> values;
 QueryFilter filter;
+OrderFilter order;  // selects only
+LimitFilter limit;  // selects only
 };
 
 struct FullQuery : Query {
@@ -231,6 +283,37 @@ QueryFilter filter;
 std::string returning;
 };
 
+// values holds one row after another, each row being its keys followed by its fields. An
+// empty value is written as the text 'NULL', the same rule as inserts and COPY
+struct BulkUpdateQuery : Query {
+std::string table;
+Fields      keys;
+Fields      fields;
+StringVec   values;
+};
+
+// deletes the rows whose `key` is any of `keys` and that also match `filter`
+template <typename T = QueryFilter>
+struct BulkDeleteQuery : Query {
+std::string table;
+std::string key;
+StringVec   keys;
+T           filter;
+};
+
+// selects the rows whose `key` is any of `keys` and that also match `filter`
+template <typename T = QueryFilter>
+struct MultiGetQuery : Query {
+std::string table;
+Fields      fields;
+std::string key;
+StringVec   keys;
+T           filter;
+};
+
+using ColumnTypes = std::unordered_map<std::string, std::string>; // column -> SQL type
+using KeyedValues = std::unordered_map<std::string, QueryValues>; // key -> its rows
+
 struct ComparisonSelectQuery : Query {
 std::string           table;
 Fields                fields;
@@ -284,4 +367,22 @@ Join                     join;
 OrderFilter              order;
 LimitFilter              limit;
 };
+
+// One page of `query` ordered by `keys` (the last one unique, e.g. tasks.id), starting after
+// the key values in `after`; an empty `after` is the first page. Pager lists every key in
+// `fields` under its full name, so each row carries its key values.
+template <typename Q>
+struct KeysetQuery
+{
+std::string              table;
+std::vector<std::string> fields;
+Q                        query;
+Fields                   keys;
+StringVec                after;
+bool                     descending{false};
+size_t                   size{100};
+};
+
+using BatchQuery  = std::variant<DatabaseQuery, InsertReturnQuery, UpdateReturnQuery>;
+using BatchResult = std::variant<QueryResult, std::string>;
 } // ns kdb
@@ -0,0 +1,875 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <db_structs.hpp>
+
+namespace kdb
+{
+inline constexpr const char* g_inner = "INNER JOIN ";
+inline constexpr const char* g_outer = "LEFT OUTER JOIN ";
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░░░ Builder ░░░░░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+// Appends a whole statement into one thread-local buffer, reserving the combined size
+// of each group of parts before copying them. The buffer keeps up to 64 KiB of capacity
+// between statements, so once warm the only allocation per statement is the copy made by
+// str(); a larger one, e.g. from a bulk insert, is released so no thread keeps its peak.
+// A builder created while another is active on the same thread gets its own buffer.
+class StatementBuilder
+{
+public:
+StatementBuilder()
+: m_arena(arena().busy ? nullptr : &arena()),
+  m_out(m_arena ? m_arena->buffer : m_local)
+{
+  if (m_arena)
+    m_arena->busy = true;
+  m_out.clear();
+}
+
+StatementBuilder(const StatementBuilder&) = delete;
+
+~StatementBuilder()
+{
+  if (!m_arena)
+    return;
+  if (m_arena->buffer.capacity() > ARENA_KEEP)
+    std::string{}.swap(m_arena->buffer);
+  m_arena->busy = false;
+}
+//----------------------------------------------------
+template <typename... Ts>
+StatementBuilder&
+append(const Ts&... parts)
+{
+  m_out.reserve(m_out.size() + (length(parts) + ...));
+  (put(parts), ...);
+  return *this;
+}
+//----------------------------------------------------
+StatementBuilder&
+quoted(std::string_view value)
+{
+  m_out.reserve(m_out.size() + value.size() + 2);
+  m_out.push_back('\'');
+  for (const char& c : value)
+  {
+    if (c == '\'')
+      m_out.push_back('\'');
+    m_out.push_back(c);
+  }
+  m_out.push_back('\'');
+  return *this;
+}
+//----------------------------------------------------
+StatementBuilder&
+placeholder(size_t index)
+{
+  char buffer[24];
+  buffer[0] = '$';
+  const auto result = std::to_chars(buffer + 1, buffer + sizeof(buffer), index);
+  m_out.append(buffer, result.ptr);
+  return *this;
+}
+//----------------------------------------------------
+void        pop_back()       { m_out.pop_back();     }
+bool        empty()    const { return m_out.empty(); }
+std::string str()      const { return m_out;         }
+
+private:
+static constexpr size_t ARENA_KEEP = 64 * 1024;
+
+struct Arena
+{
+  std::string buffer;
+  bool        busy{false};
+};
+
+static Arena&
+arena()
+{
+  thread_local Arena a;
+  return a;
+}
+
+static size_t length(char)               { return 1;          }
+static size_t length(std::string_view s) { return s.size();   }
+void          put   (char c)             { m_out.push_back(c);  }
+void          put   (std::string_view s) { m_out.append(s.data(), s.size()); }
+
+Arena*       m_arena;
+std::string  m_local;
+std::string& m_out;
+};
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░░░ Binding ░░░░░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+// Emits each value either as a quoted literal or, when preparing, as the next
+// $n placeholder. Statement text then depends only on the shape of the query.
+struct Binder
+{
+bool      prepare{false};
+StringVec values;
+
+void
+operator()(StatementBuilder& out, std::string_view value)
+{
+  if (!prepare)
+  {
+    out.quoted(value);
+    return;
+  }
+
+  values.emplace_back(value);
+  out.placeholder(values.size());
+}
+};
+
+template <typename T>
+void append_filter(StatementBuilder& out, const T& filter, Binder& binder);
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░ Helper utils ░░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+
+inline void append_fields(StatementBuilder& out, const Fields& fields)
+{
+  std::string_view delim{};
+  for (const auto &field : fields)
+  {
+    out.append(delim, field);
+    delim = ",";
+  }
+}
+//----------------------------------------------------
+inline std::string fields_string(const Fields& fields)
+{
+  StatementBuilder out;
+  append_fields(out, fields);
+  return out.str();
+}
+//----------------------------------------------------
+inline void append_values(StatementBuilder& out, const StringVec& values, size_t number_of_fields, Binder& binder)
+{
+  size_t index{1};
+
+  out.append("VALUES (");
+  for (const auto &value : values)
+  {
+    binder(out, (value.empty()) ? std::string_view{"NULL"} : std::string_view{value});
+    out.append((index++ % number_of_fields == 0) ? "),(" : ",");
+  }
+  out.pop_back();
+  out.pop_back();
+}
+//----------------------------------------------------
+inline void append_order(StatementBuilder& out, const OrderFilter& filter)
+{
+  out.append(" ORDER BY ", filter.field, ' ', filter.order);
+}
+//----------------------------------------------------
+inline void append_limit(StatementBuilder& out, const LimitFilter& filter)
+{
+  if (!filter.count.empty())
+    out.append(" LIMIT ", filter.count);
+  if (!filter.offset.empty())
+    out.append(" OFFSET ", filter.offset);
+}
+//----------------------------------------------------
+inline void append_join(StatementBuilder& out, const Join& join)
+{
+  out.append(join.type == JoinType::INNER ? g_inner : g_outer,
+             join.table, " ON ", join.table, '.', join.field, '=', join.join_table, '.', join.join_field);
+}
+//----------------------------------------------------
+inline void append_joins(StatementBuilder& out, const Joins& joins)
+{
+  std::string_view delim{};
+  for (const auto& join : joins)
+  {
+    out.append(delim);
+    append_join(out, join);
+    delim = " ";
+  }
+}
+//----------------------------------------------------
+inline void append_insert(StatementBuilder& out, const std::string& table, const Fields& fields,
+                          const StringVec& values, Binder& binder)
+{
+  out.append("INSERT INTO ", table, '(');
+  append_fields(out, fields);
+  out.append(") ");
+  append_values(out, values, fields.size(), binder);
+}
+//----------------------------------------------------
+inline std::string insert_statement(const DatabaseQuery& query, Binder& binder)
+{
+  StatementBuilder out;
+  append_insert(out, query.table, query.fields, query.values, binder);
+  return out.str();
+}
+//----------------------------------------------------
+inline std::string insert_statement(const InsertReturnQuery& query, const std::string& returning, Binder& binder)
+{
+  StatementBuilder out;
+  append_insert(out, query.table, query.fields, query.values, binder);
+  if (!returning.empty())
+    out.append(" RETURNING ", returning);
+  return out.str();
+}
+
+//----------------------------------------------------
+// To filter properly, you must have the same number of values as fields
+inline std::string update_statement(const UpdateReturnQuery& query, const std::string& returning, Binder& binder)
+{
+  if (query.filter.empty())
+    return "";
+
+  StatementBuilder out;
+  std::string_view delim{};
+  out.append("UPDATE ", query.table, " SET ");
+  if (query.values.size() == query.fields.size()) // can only update if the `fields` and
+  {                                               // `values` arguments are matching
+    for (size_t i = 0; i < query.values.size(); i++)
+    {
+      out.append(delim, query.fields[i], '=');
+      binder(out, query.values[i]);
+      delim = ",";
+    }
+  }
+  out.append(" WHERE ");
+  append_filter(out, query.filter, binder);
+  out.append(" RETURNING ", returning);
+  return out.str();
+}
+//----------------------------------------------------
+inline constexpr const char* g_bulk = "kdb_v";
+
+inline void append_cast(StatementBuilder& out, const std::string& column, const ColumnTypes& types)
+{
+  out.append(g_bulk, '.', column);
+  if (const auto it = types.find(column); it != types.end())
+    out.append("::", it->second);
+}
+//----------------------------------------------------
+/**
+ * Updates `rows` rows starting at `first` in one statement:
+ *
+ *   UPDATE t SET f=kdb_v.f::type FROM (VALUES (...),(...)) AS kdb_v(k,f)
+ *   WHERE t.k=kdb_v.k::type RETURNING t.k
+ *
+ * VALUES columns arrive untyped, so each is cast to the type of the column it targets.
+ * Every value is bound, empty ones as 'NULL' like append_values() does, so the statement
+ * text depends only on the number of rows.
+ */
+inline std::string bulk_update_statement(const BulkUpdateQuery& query, size_t first, size_t rows,
+                                         const ColumnTypes& types, Binder& binder)
+{
+  const size_t     width = query.keys.size() + query.fields.size();
+  StatementBuilder out;
+  std::string_view delim{};
+
+  out.append("UPDATE ", query.table, " SET ");
+  for (const auto& field : query.fields)
+  {
+    out.append(delim, field, '=');
+    append_cast(out, field, types);
+    delim = ",";
+  }
+
+  out.append(" FROM (VALUES ");
+  for (size_t row = first; row < first + rows; row++)
+  {
+    out.append((row == first) ? "(" : ",(");
+    for (size_t i = 0; i < width; i++)
+    {
+      const auto& value = query.values[row * width + i];
+      if (i)
+        out.append(',');
+      binder(out, (value.empty()) ? std::string_view{"NULL"} : std::string_view{value});
+    }
+    out.append(')');
+  }
+  out.append(") AS ", g_bulk, '(');
+  append_fields(out, query.keys);
+  out.append(',');
+  append_fields(out, query.fields);
+  out.append(") WHERE ");
+
+  delim = {};
+  for (const auto& key : query.keys)
+  {
+    out.append(delim, query.table, '.', key, '=');
+    append_cast(out, key, types);
+    delim = " AND ";
+  }
+
+  out.append(" RETURNING ");
+  delim = {};
+  for (const auto& key : query.keys)
+  {
+    out.append(delim, query.table, '.', key);
+    delim = ",";
+  }
+  return out.str();
+}
+//----------------------------------------------------
+template <typename T>
+std::string delete_statement(const T& query, Binder& binder)
+{
+  if constexpr (std::is_same_v<T, DatabaseQuery>)
+  {
+    if (query.filter.empty())
+      return "";
+
+    const auto& key = query.filter.front().first;
+    StatementBuilder out;
+    out.append("DELETE FROM ", query.table, " WHERE ", key, '=');
+    binder(out, query.filter.front().second);
+    out.append(" RETURNING ", key);
+    return out.str();
+  }
+  return "";
+}
+//----------------------------------------------------
+// Array literal for = ANY(...): {"a","b"} with quotes and backslashes escaped
+inline void append_array(StatementBuilder& out, const StringVec& values, size_t first, size_t count)
+{
+  out.append('{');
+  for (size_t i = first; i < first + count; i++)
+  {
+    out.append((i == first) ? "\"" : ",\"");
+    for (const char c : values[i])
+    {
+      if (c == '"' || c == '\\')
+        out.append('\\');
+      out.append(c);
+    }
+    out.append('"');
+  }
+  out.append('}');
+}
+//----------------------------------------------------
+template <typename T>
+void append_and(StatementBuilder& out, const T& filter, Binder& binder);
+//----------------------------------------------------
+// key = ANY(...) over `count` keys starting at `first`, bound as one array value
+inline void append_any(StatementBuilder& out, const std::string& key, const StringVec& keys, size_t first,
+                       size_t count, Binder& binder)
+{
+  std::string array_value;
+  {
+    StatementBuilder array;
+    append_array(array, keys, first, count);
+    array_value = array.str();
+  }
+
+  out.append(key, " = ANY(");
+  binder(out, array_value);
+  out.append(')');
+}
+//----------------------------------------------------
+/**
+ * Deletes `count` keys starting at `first` with the whole key set bound as one array:
+ *
+ *   DELETE FROM t WHERE key = ANY('{"1","2"}') AND <filter> RETURNING key
+ *
+ * The array is a single parameter, so one prepared statement serves every chunk.
+ */
+template <typename T>
+std::string bulk_delete_statement(const BulkDeleteQuery<T>& query, size_t first, size_t count, Binder& binder)
+{
+  StatementBuilder out;
+  out.append("DELETE FROM ", query.table, " WHERE ");
+  append_any(out, query.key, query.keys, first, count, binder);
+  append_and(out, query.filter, binder);
+  out.append(" RETURNING ", query.key);
+  return out.str();
+}
+//----------------------------------------------------
+/**
+ * Selects `fields` for `count` keys starting at `first`, bound the same way:
+ *
+ *   SELECT f1,f2,key FROM t WHERE key = ANY('{"1","2"}') AND <filter>
+ */
+template <typename T>
+std::string multi_get_statement(const MultiGetQuery<T>& query, const Fields& fields, size_t first, size_t count,
+                                Binder& binder)
+{
+  StatementBuilder out;
+  out.append("SELECT ");
+  append_fields(out, fields);
+  out.append(" FROM ", query.table, " WHERE ");
+  append_any(out, query.key, query.keys, first, count, binder);
+  append_and(out, query.filter, binder);
+  return out.str();
+}
+
+//  ┌─────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░ Visitors ░░░░░░░░░░░░░░│  //
+//  └─────────────────────────────────────┘  //
+struct FilterVisitor
+{
+//----------------------------------------------------
+void
+operator()(const MultiOptionFilter& f)
+{
+  std::string_view delim{};
+  _M_out.append(f.a, ' ', f.comparison, " (");
+  for (const auto &option : f.options)
+  {
+    _M_out.append(delim, option);
+    delim = ",";
+  }
+  _M_out.append(')');
+}
+//----------------------------------------------------
+void
+operator()(const CompBetweenFilter& filter)
+{
+  _M_out.append(filter.field, " BETWEEN ", filter.a, " AND ", filter.b);
+}
+//----------------------------------------------------
+void
+operator()(const CompFilter& filter)
+{
+  _M_out.append(filter.a, filter.sign, filter.b);
+}
+//----------------------------------------------------
+void
+operator()(const QueryComparisonFilter& filter)
+{
+  _M_out.append(std::get<0>(filter[0]), std::get<1>(filter[0]), std::get<2>(filter[0]));
+}
+//----------------------------------------------------
+void
+operator()(const QueryFilter& filter)
+{
+  std::string_view delim{};
+  for (const auto& f : filter)
+  {
+    _M_out.append(delim, f.first, '=');
+    _M_binder(_M_out, f.second);
+    delim = " AND ";
+  }
+}
+//----------------------------------------------------
+void
+operator()(const GenericFilter& filter)
+{
+  _M_out.append(filter.a, filter.comparison, filter.b);
+}
+
+StatementBuilder& _M_out;
+Binder&           _M_binder;
+};
+
+//  ┌─────────────────────────────────────┐  //
+//  │░░░░░░░░░░ Visitor Helpers ░░░░░░░░░░░│  //
+//  └─────────────────────────────────────┘  //
+// Filters the FilterVisitor writes; QueryFilter converts from anything, so they are named
+template <typename T>
+struct is_filter : std::disjunction<std::is_same<T, QueryFilter>,       std::is_same<T, QueryComparisonFilter>,
+                                    std::is_same<T, CompFilter>,        std::is_same<T, CompBetweenFilter>,
+                                    std::is_same<T, MultiOptionFilter>, std::is_same<T, GenericFilter>> {};
+
+template <typename T>
+struct is_variant : std::false_type {};
+
+template <typename... Ts>
+struct is_variant<std::variant<Ts...>> : std::true_type {};
+
+template <typename T, typename = void>
+struct has_empty : std::false_type {};
+
+template <typename T>
+struct has_empty<T, std::void_t<decltype(std::declval<const T&>().empty())>> : std::true_type {};
+//----------------------------------------------------
+// Whether a filter adds no condition; single filters always add one
+template <typename T>
+bool empty_filter(const T& filter)
+{
+  if constexpr (has_empty<T>::value)
+    return filter.empty();
+  else
+    return false;
+}
+//----------------------------------------------------
+/**
+ * Conditions for any composition of filters, resolved at compile time: a filter the
+ * FilterVisitor knows is written directly, a variant by std::visit over its
+ * alternatives, and any other container is a list whose entries are joined by AND.
+ * Lists and variants nest, so std::vector<std::variant<CompFilter, QueryFilter>> or
+ * std::vector<QueryFilter> need nothing beyond the filters themselves.
+ */
+template <typename T>
+void append_filter(StatementBuilder& out, const T& filter, Binder& binder)
+{
+  if constexpr (is_filter<T>::value)
+    FilterVisitor{out, binder}(filter);
+  else
+  if constexpr (is_variant<T>::value)
+    std::visit([&out, &binder](const auto& alternative) { append_filter(out, alternative, binder); }, filter);
+  else
+  {
+    std::string_view delim{};
+    for (const auto& entry : filter)
+    {
+      out.append(delim);
+      append_filter(out, entry, binder);
+      delim = " AND ";
+    }
+  }
+}
+//----------------------------------------------------
+template <typename T>
+std::string filter_statement(const T& filter, Binder& binder)
+{
+  StatementBuilder out;
+  append_filter(out, filter, binder);
+  return out.str();
+}
+//----------------------------------------------------
+// Extra conditions after an existing WHERE clause; empty filters add nothing
+template <typename T>
+void append_and(StatementBuilder& out, const T& filter, Binder& binder)
+{
+  if (empty_filter(filter))
+    return;
+  out.append(" AND ");
+  append_filter(out, filter, binder);
+}
+
+//******************************************************************************************//
+
+// Shapes that carry ORDER BY and LIMIT/OFFSET bounds
+template <typename T, typename = void>
+struct has_bounds : std::false_type {};
+
+template <typename T>
+struct has_bounds<T, std::void_t<decltype(std::declval<const T&>().order),
+                                 decltype(std::declval<const T&>().limit)>> : std::true_type {};
+//----------------------------------------------------
+inline constexpr const char* UNSUPPORTED = "SELECT 1";
+template <typename T>
+struct SelectVisitor
+{
+StatementBuilder& _M_out;
+Binder&           _M_binder;
+
+SelectVisitor(const T& query, StatementBuilder& out, Binder& binder)
+: _M_out(out),
+  _M_binder(binder)
+{
+  if (!empty_filter(query.filter))
+    operator()(query);
+  else
+  {
+    select(query);
+    joins(query);
+  }
+  bounds(query);
+}
+//----------------------------------------------------
+template <typename Q>
+void
+select(const Q& query)
+{
+  _M_out.append("SELECT ");
+  append_fields(_M_out, query.fields);
+  _M_out.append(" FROM ", query.table);
+}
+//----------------------------------------------------
+template <typename Q>
+void
+joins(const Q&) {}
+
+template <typename F>
+void
+joins(const JoinQuery<F>& query)
+{
+  _M_out.append(' ');
+  append_joins(_M_out, query.joins);
+}
+
+void
+joins(const SimpleJoinQuery& query)
+{
+  _M_out.append(' ');
+  append_join(_M_out, query.join);
+}
+//----------------------------------------------------
+template <typename Q>
+void
+bounds(const Q& query)
+{
+  if constexpr (has_bounds<Q>::value)
+  {
+    if (query.order.has_value()) append_order(_M_out, query.order);
+    if (query.limit.has_value()) append_limit(_M_out, query.limit);
+  }
+}
+//----------------------------------------------------
+void
+operator()(const DatabaseQuery& query)
+{
+  const auto&      filter = query.filter;
+  std::string_view delim{};
+  select(query);
+  if (filter.size() > 1 &&
+      filter.front().first == filter.at(1).first)
+  {
+    _M_out.append(" WHERE ", filter.front().first, " in (");
+    for (const auto &filter_pair : filter)
+    {
+      _M_out.append(delim);
+      _M_binder(_M_out, filter_pair.second);
+      delim = ",";
+    }
+    _M_out.append(')');
+  }
+  else
+  {
+    _M_out.append(" WHERE ");
+    append_filter(_M_out, filter, _M_binder);
+  }
+}
+//----------------------------------------------------
+void
+operator()(const ComparisonSelectQuery& query)
+{
+  if (query.filter.size() > 1)
+  {
+    _M_out.append(UNSUPPORTED);
+    return;
+  }
+
+  select(query);
+  _M_out.append(" WHERE ");
+  for (const auto &filter_tup : query.filter)
+    _M_out.append(std::get<0>(filter_tup), std::get<1>(filter_tup), std::get<2>(filter_tup));
+}
+//----------------------------------------------------
+void
+operator()(const ComparisonBetweenSelectQuery& query)
+{
+  if (query.filter.size() > 1)
+  {
+    _M_out.append(UNSUPPORTED);
+    return;
+  }
+
+  select(query);
+  _M_out.append(" WHERE ");
+  for (const auto &filter : query.filter)
+    append_filter(_M_out, filter, _M_binder);
+}
+//----------------------------------------------------
+void
+operator()(const MultiFilterSelect& query)
+{
+  select(query);
+  _M_out.append(" WHERE ");
+  append_filter(_M_out, query.filter, _M_binder);
+}
+//----------------------------------------------------
+template <typename F>
+void
+operator()(const MultiVariantFilterSelect<F>& query)
+{
+  select(query);
+  _M_out.append(" WHERE ");
+  append_filter(_M_out, query.filter, _M_binder);
+}
+//----------------------------------------------------
+template <typename F>
+void
+operator()(const JoinQuery<F>& query)
+{
+  select(query);
+  joins(query);
+  _M_out.append(" WHERE ");
+  append_filter(_M_out, query.filter, _M_binder);
+}
+//----------------------------------------------------
+void
+operator()(const SimpleJoinQuery& query)
+{
+  select(query);
+  joins(query);
+  _M_out.append(" WHERE ");
+  append_filter(_M_out, query.filter, _M_binder);
+}
+};
+
+//----------------------------------------------------
+template <typename T>
+std::string select_statement(const T& query, Binder& binder)
+{
+  StatementBuilder out;
+  SelectVisitor<T>{query, out, binder};
+  return out.str();
+}
+//----------------------------------------------------
+// Unambiguous name the keyset statement gives its i-th key inside kdb_page
+inline std::string key_alias(size_t i)
+{
+  return "kdb_k" + std::to_string(i);
+}
+
+// Trailing column of a keyset page telling whether any key of the row is NULL
+inline constexpr const char* KEY_NULL_FIELD = "kdb_null_key";
+//----------------------------------------------------
+/**
+ * Keyset page over any select shape:
+ *
+ *   SELECT *,(kdb_k0 IS NULL OR kdb_k1 IS NULL) AS kdb_null_key
+ *     FROM (SELECT ..., t.k1 AS kdb_k0, ... <query>) AS kdb_page
+ *     WHERE (kdb_k0,kdb_k1) > ($1,$2) ORDER BY kdb_k0,kdb_k1 LIMIT size+1
+ *
+ * Each key is matched to a selected field by its full name and aliased in place, so
+ * tasks.id and owners.id of a join stay apart and the columns keep their positions;
+ * a key that is not selected is added at the end. The server flattens the subquery,
+ * so an index on the keys serves every page at the same cost. One extra row is
+ * fetched to tell whether another page follows. kdb_null_key lets the Pager refuse
+ * NULL keys, which the row comparison cannot continue from and a text row cannot
+ * tell apart from empty strings.
+ */
+template <typename Q>
+std::string select_statement(const KeysetQuery<Q>& page, Binder& binder)
+{
+  Q inner      = page.query;
+  inner.fields = page.fields;
+  inner.order  = OrderFilter{};
+  inner.limit  = LimitFilter{};
+  for (size_t i = 0; i < page.keys.size(); i++)
+  {
+    const auto it = std::find(inner.fields.begin(), inner.fields.end(), page.keys[i]);
+    if (it == inner.fields.end())
+      inner.fields.push_back(page.keys[i] + " AS " + key_alias(i));
+    else
+      it->append(" AS ").append(key_alias(i));
+  }
+  const std::string from = select_statement(inner, binder);
+
+  StatementBuilder out;
+  std::string_view delim{};
+  out.append("SELECT *,(");
+  for (size_t i = 0; i < page.keys.size(); i++)
+  {
+    out.append(delim, key_alias(i), " IS NULL");
+    delim = " OR ";
+  }
+  out.append(") AS ", KEY_NULL_FIELD, " FROM (", from, ") AS kdb_page");
+  delim = {};
+  if (!page.after.empty())
+  {
+    out.append(" WHERE (");
+    for (size_t i = 0; i < page.keys.size(); i++)
+    {
+      out.append(delim, key_alias(i));
+      delim = ",";
+    }
+    out.append((page.descending) ? ") < (" : ") > (");
+    delim = {};
+    for (const auto& value : page.after)
+    {
+      out.append(delim);
+      binder(out, value);
+      delim = ",";
+    }
+    out.append(')');
+  }
+
+  out.append(" ORDER BY ");
+  delim = {};
+  for (size_t i = 0; i < page.keys.size(); i++)
+  {
+    out.append(delim, key_alias(i), (page.descending) ? " DESC" : " ASC");
+    delim = ",";
+  }
+  out.append(" LIMIT ", std::to_string(page.size + 1));
+  return out.str();
+}
+//----------------------------------------------------
+// Statement for one entry of a Batch
+inline std::string batch_statement(const BatchQuery& query, Binder& binder)
+{
+  return std::visit([&binder](const auto& q) -> std::string
+  {
+    using T = std::decay_t<decltype(q)>;
+    if constexpr (std::is_same_v<T, InsertReturnQuery>)
+      return insert_statement(q, q.returning, binder);
+    else
+    if constexpr (std::is_same_v<T, UpdateReturnQuery>)
+      return update_statement(q, q.returning, binder);
+    else
+    switch (q.type)
+    {
+      case QueryType::INSERT: return insert_statement(q, binder);
+      case QueryType::DELETE: return delete_statement(q, binder);
+      case QueryType::SELECT: return select_statement(q, binder);
+      default:
+        throw std::invalid_argument{"Batches take a DatabaseQuery only as an INSERT, DELETE or SELECT; "
+                                    "use UpdateReturnQuery for updates"};
+    }
+  }, query);
+}
+//----------------------------------------------------
+/**
+ * Every table a select reads from, so cached results can be dropped when any of them
+ * is written.
+ */
+template <typename T>
+std::vector<std::string> query_tables(const T& query)
+{
+  return {query.table};
+}
+
+inline void add_join_table(std::vector<std::string>& tables, const Join& join)
+{
+  if (std::find(tables.begin(), tables.end(), join.table) == tables.end())
+    tables.push_back(join.table);
+}
+
+template <typename T>
+std::vector<std::string> query_tables(const JoinQuery<T>& query)
+{
+  std::vector<std::string> tables{query.table};
+  for (const auto& join : query.joins)
+    add_join_table(tables, join);
+  return tables;
+}
+
+inline std::vector<std::string> query_tables(const SimpleJoinQuery& query)
+{
+  std::vector<std::string> tables{query.table};
+  add_join_table(tables, query.join);
+  return tables;
+}
+
+template <typename Q>
+std::vector<std::string> query_tables(const KeysetQuery<Q>& page)
+{
+  return query_tables(page.query);
+}
+//----------------------------------------------------
+// Names of the columns a select returns, in order
+template <typename T>
+const std::vector<std::string>& result_fields(const T& query)
+{
+  return query.fields;
+}
+
+template <typename Q>
+std::vector<std::string> result_fields(const KeysetQuery<Q>& page)
+{
+  std::vector<std::string> fields = page.fields;
+  fields.emplace_back(KEY_NULL_FIELD);
+  return fields;
+}
+} // ns kdb
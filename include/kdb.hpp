@@ -2,44 +2,69 @@
 
 #include <variant>
 #include <iostream>
+#include "batch.hpp"
 #include "database_connection.hpp"
+#include "pager.hpp"
+#include "query_stats.hpp"
+#include "reactor.hpp"
+#include "row_traits.hpp"
+#include "thread_pool.hpp"
+#include "write_buffer.hpp"
 #include <memory>
+#include <unordered_map>
 
 namespace kdb {
+/**
+ * One KDB can be shared by any number of threads: statements run on connections leased
+ * from its pool, which hands each thread back the connection it used last. Configure it
+ * before sharing it; an observer can be installed or replaced at any time.
+ */
 class KDB {
  public:
-  KDB(dbconfig config = {}) : m_connection(std::move(std::unique_ptr<db_cxn>{new db_cxn}))
+  KDB(dbconfig config = {}) : m_connection(std::move(std::unique_ptr<db_cxn>{new db_cxn})),
+                              m_async_workers(config.async_workers)
   {
     if (!config.validate())
       throw std::invalid_argument{"Please provide valid kdb::dbconfig object"};
     m_connection->set_config(config);
   }
 
+  /**
+   * Async calls already queued on `k` captured `k` itself, so its workers finish them
+   * before anything is moved; the new KDB starts its own workers on first use.
+   */
   KDB(KDB&& k) :
-    m_connection(std::move(k.m_connection)),
-    m_credentials(std::move(k.m_credentials))
+    m_connection(std::move(drained(k).m_connection)),
+    m_credentials(std::move(k.m_credentials)),
+    m_async_workers(k.m_async_workers),
+    m_buffers(std::move(k.m_buffers))
   {}
 
   KDB(std::unique_ptr<db_cxn> db_connection, dbconfig config)
-  : m_connection(std::move(db_connection))
+  : m_connection(std::move(db_connection)),
+    m_async_workers(config.async_workers)
   {
     m_connection->set_config(config);
   }
 
   ~KDB() = default;
 
-QueryValues select(std::string table, Fields fields, QueryFilter filter = {}, uint32_t limit = 0) const
+QueryValues select(std::string table, Fields fields, QueryFilter filter = {}, uint32_t limit = 0,
+                   uint32_t offset = 0) const
 {
   try
   {
     QueryResult result = m_connection->query(
       DatabaseQuery{
-        .table = table,
-        .fields = fields,
+        .table = std::move(table),
+        .fields = std::move(fields),
         .type = QueryType::SELECT,
         .values = {},
-        .filter = filter});
-    return result.values;
+        .filter = std::move(filter),
+        .order = {},
+        .limit = LimitFilter{(limit)  ? std::to_string(limit)  : std::string{},
+                             (offset) ? std::to_string(offset) : std::string{}}});
+    return std::move(result.values);
   }
   catch (const pqxx::sql_error& e)
   {
@@ -58,12 +83,12 @@ QueryValues select(std::string table, Fields fields,
   {
     QueryResult result = m_connection->query(
       ComparisonSelectQuery{
-        .table = table,
-        .fields = fields,
+        .table = std::move(table),
+        .fields = std::move(fields),
         .values = {},
-        .filter = filter
+        .filter = std::move(filter)
       });
-    return result.values;
+    return std::move(result.values);
 
   }
   catch (const pqxx::sql_error &e)
@@ -82,13 +107,13 @@ QueryValues select(std::string table, Fields fields,
     try
     {
       ComparisonBetweenSelectQuery select_query{
-        .table  = table,
-        .fields = fields,
+        .table  = std::move(table),
+        .fields = std::move(fields),
         .values = {},
-        .filter = filter
+        .filter = std::move(filter)
       };
-      QueryResult result = m_connection->query(select_query);
-      return result.values;
+      QueryResult result = m_connection->query(std::move(select_query));
+      return std::move(result.values);
 
     }
     catch (const pqxx::sql_error &e)
@@ -109,14 +134,14 @@ QueryValues select(std::string table, Fields fields,
     try
     {
       MultiFilterSelect select_query{
-        .table  = table,
-        .fields = fields,
-        .filter = filters,
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filters),
         .order  = order,
         .limit  = limit
       };
-      QueryResult result = m_connection->query(select_query);
-      return result.values;
+      QueryResult result = m_connection->query(std::move(select_query));
+      return std::move(result.values);
     }
     catch (const pqxx::sql_error &e)
     {
@@ -128,19 +153,25 @@ QueryValues select(std::string table, Fields fields,
     }
   }
 
-  template <typename FilterA, typename FilterB>
-  QueryValues selectMultiFilter(
-      std::string table, Fields fields,
-      std::vector<std::variant<FilterA, FilterB>> filters)
-      {
+  /**
+   * Selects the rows matching every filter, each any of the filter types, e.g.
+   * std::vector<std::variant<CompFilter, CompBetweenFilter, QueryFilter>>.
+   */
+  template <typename... Filters>
+  QueryValues selectMultiFilter(std::string                           table,
+                                Fields                                fields,
+                                std::vector<std::variant<Filters...>> filters,
+                                OrderFilter                           order = OrderFilter{},
+                                LimitFilter                           limit = LimitFilter{})
+  {
     try
     {
-      MultiVariantFilterSelect<std::vector<std::variant<FilterA, FilterB>>> select_query{
-        .table  = table,
-        .fields = fields,
-        .filter = filters};
-      QueryResult result = m_connection->query(select_query);
-      return result.values;
+      return m_connection->query(MultiVariantFilterSelect<std::vector<std::variant<Filters...>>>{
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filters),
+        .order  = std::move(order),
+        .limit  = std::move(limit)}).values;
     }
     catch (const pqxx::sql_error &e)
     {
@@ -152,26 +183,23 @@ QueryValues select(std::string table, Fields fields,
     }
   }
 
-  template <typename FilterA, typename FilterB, typename FilterC>
-  QueryValues selectMultiFilter(
-      const std::string&                                          table,
-      const Fields&                                               fields,
-      const std::vector<std::variant<FilterA, FilterB, FilterC>>& filters,
-      const OrderFilter&                                          order = OrderFilter{},
-      const LimitFilter&                                          limit = LimitFilter{}
-      )
+  template <typename T = std::vector<QueryFilter>>
+  QueryValues selectJoin(std::string table,
+                         Fields      fields,
+                         T           filters,
+                         Joins       joins,
+                         OrderFilter order = OrderFilter{},
+                         LimitFilter limit = LimitFilter{}) const
   {
     try
     {
-      MultiVariantFilterSelect<std::vector<std::variant<FilterA, FilterB, FilterC>>> select_query{
-        .table  = table,
-        .fields = fields,
-        .filter = filters,
-        .order  = order,
-        .limit  = limit
-      };
-      QueryResult result = m_connection->query(select_query);
-      return result.values;
+      return m_connection->query(JoinQuery<T>{
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filters),
+        .joins  = std::move(joins),
+        .order  = std::move(order),
+        .limit  = std::move(limit)}).values;
     }
     catch (const pqxx::sql_error &e)
     {
@@ -183,24 +211,18 @@ QueryValues select(std::string table, Fields fields,
     }
   }
 
-  template <typename FilterA, typename FilterB>
-  QueryValues selectMultiFilter(const std::string&                          table,
-                                const Fields&                               fields,
-                                std::vector<std::variant<FilterA, FilterB>> filters,
-                                const OrderFilter&                          order,
-                                const LimitFilter&                          limit)
+  QueryValues selectSimpleJoin(std::string table, Fields fields, QueryFilter filter, Join join)  const
   {
-    try
-    {
-      MultiVariantFilterSelect<std::vector<std::variant<FilterA, FilterB>>> select_query{
-        .table  = table,
-        .fields = fields,
-        .filter = filters,
-        .order  = order,
-        .limit  = limit
+    try {
+      SimpleJoinQuery select_query{
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filter),
+        .join   = std::move(join)
       };
-      QueryResult result = m_connection->query(select_query);
-      return result.values;
+      QueryResult result = m_connection->query(std::move(select_query));
+      return std::move(result.values);
+
     }
     catch (const pqxx::sql_error &e)
     {
@@ -212,54 +234,267 @@ QueryValues select(std::string table, Fields fields,
     }
   }
 
+  /**
+   * Pages through selectMultiFilter results by keyset, `size` rows at a time, ordered by
+   * `keys` (the last one unique, e.g. "id"). See Pager.
+   */
+  template <typename... Filters>
+  Pager<MultiVariantFilterSelect<std::vector<std::variant<Filters...>>>>
+  pageMultiFilter(std::string                           table,
+                  Fields                                fields,
+                  std::vector<std::variant<Filters...>> filters,
+                  Fields                                keys,
+                  size_t                                size,
+                  bool                                  descending = false)
+  {
+    return {*m_connection, MultiVariantFilterSelect<std::vector<std::variant<Filters...>>>{
+      .table  = std::move(table),
+      .fields = std::move(fields),
+      .filter = std::move(filters)}, std::move(keys), size, descending};
+  }
+
   template <typename T = std::vector<QueryFilter>>
-  QueryValues selectJoin(const std::string& table,
-                         const Fields&      fields,
-                         const T&           filters,
-                         const Joins&       joins,
-                         const OrderFilter& order = OrderFilter{},
-                         const LimitFilter& limit = LimitFilter{}) const
+  Pager<JoinQuery<T>> pageJoin(std::string table,
+                               Fields      fields,
+                               T           filters,
+                               Joins       joins,
+                               Fields      keys,
+                               size_t      size,
+                               bool        descending = false)
+  {
+    return {*m_connection, JoinQuery<T>{
+      .table  = std::move(table),
+      .fields = std::move(fields),
+      .filter = std::move(filters),
+      .joins  = std::move(joins)}, std::move(keys), size, descending};
+  }
+
+  template <typename Row, typename = IsRow<Row>>
+  std::vector<Row> select(std::string table, QueryFilter filter = {}) const
   {
     try
     {
-      return m_connection->query(JoinQuery<T>{
-        .table  = table,
-        .fields = fields,
-        .filter = filters,
-        .joins  = joins,
-        .order  = order,
-        .limit  = limit}).values;
+      return m_connection->decode<Row>(
+        DatabaseQuery{
+          .table  = std::move(table),
+          .fields = row_fields<Row>(),
+          .type   = QueryType::SELECT,
+          .values = {},
+          .filter = std::move(filter)});
     }
     catch (const pqxx::sql_error &e)
     {
-      throw e;
+      throw;
     }
     catch (const std::exception &e)
     {
-      throw e;
+      throw;
     }
   }
 
-  QueryValues selectSimpleJoin(std::string table, Fields fields, QueryFilter filter, Join join)  const
+  template <typename Row, typename... Filters, typename = IsRow<Row>>
+  std::vector<Row> selectMultiFilter(std::string                           table,
+                                     std::vector<std::variant<Filters...>> filters,
+                                     OrderFilter                           order = OrderFilter{},
+                                     LimitFilter                           limit = LimitFilter{}) const
   {
-    try {
-      SimpleJoinQuery select_query{
-        .table  = table,
-        .fields = fields,
-        .filter = filter,
-        .join   = join
-      };
-      QueryResult result = m_connection->query(select_query);
-      return result.values;
+    try
+    {
+      return m_connection->decode<Row>(MultiVariantFilterSelect<std::vector<std::variant<Filters...>>>{
+        .table  = std::move(table),
+        .fields = row_fields<Row>(),
+        .filter = std::move(filters),
+        .order  = std::move(order),
+        .limit  = std::move(limit)});
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
 
+  template <typename Row, typename T = std::vector<QueryFilter>, typename = IsRow<Row>>
+  std::vector<Row> selectJoin(std::string table,
+                              T           filters,
+                              Joins       joins,
+                              OrderFilter order = OrderFilter{},
+                              LimitFilter limit = LimitFilter{}) const
+  {
+    try
+    {
+      return m_connection->decode<Row>(JoinQuery<T>{
+        .table  = std::move(table),
+        .fields = row_fields<Row>(),
+        .filter = std::move(filters),
+        .joins  = std::move(joins),
+        .order  = std::move(order),
+        .limit  = std::move(limit)});
     }
     catch (const pqxx::sql_error &e)
     {
-      throw e;
+      throw;
     }
     catch (const std::exception &e)
     {
-      throw e;
+      throw;
+    }
+  }
+
+  ResultSet selectCompact(std::string table, Fields fields, QueryFilter filter = {}) const
+  {
+    try
+    {
+      return m_connection->fetch(
+        DatabaseQuery{
+          .table  = std::move(table),
+          .fields = std::move(fields),
+          .type   = QueryType::SELECT,
+          .values = {},
+          .filter = std::move(filter)});
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  template <typename... Filters>
+  ResultSet selectMultiFilterCompact(std::string                           table,
+                                     Fields                                fields,
+                                     std::vector<std::variant<Filters...>> filters,
+                                     OrderFilter                           order = OrderFilter{},
+                                     LimitFilter                           limit = LimitFilter{}) const
+  {
+    try
+    {
+      return m_connection->fetch(MultiVariantFilterSelect<std::vector<std::variant<Filters...>>>{
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filters),
+        .order  = std::move(order),
+        .limit  = std::move(limit)});
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  template <typename T = std::vector<QueryFilter>>
+  ResultSet selectJoinCompact(std::string table,
+                              Fields      fields,
+                              T           filters,
+                              Joins       joins,
+                              OrderFilter order = OrderFilter{},
+                              LimitFilter limit = LimitFilter{}) const
+  {
+    try
+    {
+      return m_connection->fetch(JoinQuery<T>{
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filters),
+        .joins  = std::move(joins),
+        .order  = std::move(order),
+        .limit  = std::move(limit)});
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  size_t selectStream(std::string table, Fields fields, QueryFilter filter, const RowCallback& callback) const
+  {
+    try
+    {
+      return m_connection->stream(
+        DatabaseQuery{
+          .table  = std::move(table),
+          .fields = std::move(fields),
+          .type   = QueryType::SELECT,
+          .values = {},
+          .filter = std::move(filter)}, callback);
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  template <typename... Filters>
+  size_t selectMultiFilterStream(std::string                           table,
+                                 Fields                                fields,
+                                 std::vector<std::variant<Filters...>> filters,
+                                 const RowCallback&                    callback,
+                                 OrderFilter                           order = OrderFilter{},
+                                 LimitFilter                           limit = LimitFilter{}) const
+  {
+    try
+    {
+      return m_connection->stream(MultiVariantFilterSelect<std::vector<std::variant<Filters...>>>{
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filters),
+        .order  = std::move(order),
+        .limit  = std::move(limit)}, callback);
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  template <typename T = std::vector<QueryFilter>>
+  size_t selectJoinStream(std::string        table,
+                          Fields             fields,
+                          T                  filters,
+                          Joins              joins,
+                          const RowCallback& callback,
+                          OrderFilter        order = OrderFilter{},
+                          LimitFilter        limit = LimitFilter{}) const
+  {
+    try
+    {
+      return m_connection->stream(JoinQuery<T>{
+        .table  = std::move(table),
+        .fields = std::move(fields),
+        .filter = std::move(filters),
+        .joins  = std::move(joins),
+        .order  = std::move(order),
+        .limit  = std::move(limit)}, callback);
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
     }
   }
 
@@ -269,14 +504,14 @@ QueryValues select(std::string table, Fields fields,
   try
   {
       UpdateReturnQuery update_query{
-        .table     = table,
-        .fields    = fields,
+        .table     = std::move(table),
+        .fields    = std::move(fields),
         .type      = QueryType::UPDATE,
-        .values    = values,
-        .filter    = filter,
-        .returning = returning};
+        .values    = std::move(values),
+        .filter    = std::move(filter),
+        .returning = std::move(returning)};
 
-      return m_connection->query(update_query);
+      return m_connection->query(std::move(update_query));
     }
     catch (const pqxx::sql_error &e)
     {
@@ -296,14 +531,14 @@ QueryValues select(std::string table, Fields fields,
     {
       auto result = m_connection->query(
         DatabaseQuery{
-          .table  = table,
+          .table  = std::move(table),
           .fields = {},
           .type   = QueryType::DELETE,
           .values = {},
-          .filter = filter});
+          .filter = std::move(filter)});
 
-      if (!result.values.empty())
-        return result.values.at(0).second;
+      if (!result.values.empty() && !result.values.front().empty())
+        return result.values.at(0).begin()->second;
 
     }
     catch (const pqxx::sql_error &e)
@@ -324,10 +559,10 @@ QueryValues select(std::string table, Fields fields,
     {
       QueryResult result = m_connection->query(
         DatabaseQuery{
-          .table  = table,
-          .fields = fields,
+          .table  = std::move(table),
+          .fields = std::move(fields),
           .type   = QueryType::INSERT,
-          .values = values,
+          .values = std::move(values),
           .filter = QueryFilter{}});
 
     }
@@ -343,6 +578,109 @@ QueryValues select(std::string table, Fields fields,
     return true;
   }
 
+  size_t bulk_insert(std::string table, Fields fields, Values values)
+  {
+    try
+    {
+      return m_connection->bulk_insert(
+        DatabaseQuery{
+          .table  = std::move(table),
+          .fields = std::move(fields),
+          .type   = QueryType::INSERT,
+          .values = std::move(values),
+          .filter = QueryFilter{}});
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  /**
+   * Updates many rows by key. Each row of values is its keys followed by its fields, e.g.
+   * keys {"id"}, fields {"name", "value"}, values {"1", "a", "10", "2", "b", "20"}.
+   * Returns the keys of the rows that were updated.
+   */
+  QueryValues bulk_update(std::string table, Fields keys, Fields fields, Values values)
+  {
+    try
+    {
+      return m_connection->bulk_update(
+        BulkUpdateQuery{
+          .table  = std::move(table),
+          .keys   = std::move(keys),
+          .fields = std::move(fields),
+          .values = std::move(values)});
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  /**
+   * Deletes every row whose `key` is one of `keys` and that also matches `filter`, e.g.
+   * bulk_remove("sessions", "id", expired_ids) or with CreateFilter("status", "expired").
+   * Returns the deleted keys; their count is the number of rows removed.
+   */
+  template <typename T = QueryFilter>
+  StringVec bulk_remove(std::string table, std::string key, StringVec keys, T filter = T{})
+  {
+    try
+    {
+      return m_connection->bulk_delete(
+        BulkDeleteQuery<T>{
+          .table  = std::move(table),
+          .key    = std::move(key),
+          .keys   = std::move(keys),
+          .filter = std::move(filter)});
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  /**
+   * Selects the rows of every key in `keys` at once, grouped by key, e.g.
+   * multi_get("users", {"id", "name"}, "id", ids).at("42"). Large key sets are split into
+   * chunks that run in parallel on the async workers.
+   */
+  template <typename T = QueryFilter>
+  KeyedValues multi_get(std::string table, Fields fields, std::string key, StringVec keys, T filter = T{})
+  {
+    try
+    {
+      return m_connection->multi_get(
+        MultiGetQuery<T>{
+          .table  = std::move(table),
+          .fields = std::move(fields),
+          .key    = std::move(key),
+          .keys   = std::move(keys),
+          .filter = std::move(filter)}, &workers());
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
   std::string insert(std::string table, Fields fields, Values values,
                      std::string returning)
   {
@@ -350,11 +688,11 @@ QueryValues select(std::string table, Fields fields,
     {
       return m_connection->query(
         InsertReturnQuery{
-          .table     = table,
-          .fields    = fields,
+          .table     = std::move(table),
+          .fields    = std::move(fields),
           .type      = QueryType::INSERT,
-          .values    = values,
-          .returning = returning});
+          .values    = std::move(values),
+          .returning = std::move(returning)});
 
     }
     catch (const pqxx::sql_error &e)
@@ -367,9 +705,170 @@ QueryValues select(std::string table, Fields fields,
     }
   }
 
+  std::vector<BatchResult> execute(const Batch& batch)
+  {
+    try
+    {
+      if (batch.empty())
+        return {};
+      return m_connection->execute(batch.queries());
+    }
+    catch (const pqxx::sql_error &e)
+    {
+      throw;
+    }
+    catch (const std::exception &e)
+    {
+      throw;
+    }
+  }
+
+  void observe(std::shared_ptr<QueryObserver> observer)
+  {
+    m_connection->set_observer(std::move(observer));
+  }
+
+  /**
+   * Drops cached selects that read from table. Writes made through this KDB do this on
+   * their own; call it when the table is changed elsewhere.
+   */
+  void invalidate(const std::string& table)
+  {
+    m_connection->invalidate(table);
+  }
+
+  CacheStats cacheStats() const
+  {
+    return m_connection->cache_stats();
+  }
+
+  std::unique_ptr<Transaction> begin()
+  {
+    return m_connection->begin();
+  }
+
+  /**
+   * A reactor with dbconfig::reactor_size connections of its own to the configured
+   * database, for running many queries from one event-loop thread. See reactor.
+   */
+  std::unique_ptr<reactor> openReactor()
+  {
+    return m_connection->open_reactor();
+  }
+
+  /**
+   * Runs fn(Transaction&) and commits once it returns. If fn throws, the transaction is
+   * rolled back and the exception propagates.
+   */
+  template <typename F>
+  auto transaction(F&& fn) -> std::invoke_result_t<F, Transaction&>
+  {
+    auto tx = begin();
+    if constexpr (std::is_void_v<std::invoke_result_t<F, Transaction&>>)
+    {
+      fn(*tx);
+      tx->commit();
+    }
+    else
+    {
+      auto result = fn(*tx);
+      tx->commit();
+      return result;
+    }
+  }
+
+  /**
+   * The write-behind buffer of an append-only table, created with `fields` and `config`
+   * on first use, e.g. buffer("events", {"type", "payload"}).insert({"click", "{}"}).
+   * Buffered rows are written when the KDB goes away.
+   */
+  WriteBuffer& buffer(const std::string& table, Fields fields, bufferconfig config = {})
+  {
+    std::lock_guard<std::mutex> lock(m_buffers_mutex);
+    auto& buffer = m_buffers[table];
+    if (!buffer)
+      buffer = std::make_unique<WriteBuffer>(*m_connection, table, std::move(fields), config);
+    return *buffer;
+  }
+
+  void flush()
+  {
+    std::lock_guard<std::mutex> lock(m_buffers_mutex);
+    for (auto& [table, buffer] : m_buffers)
+      buffer->flush();
+  }
+
+  std::future<QueryValues> selectAsync(std::string table, Fields fields, QueryFilter filter = {})
+  {
+    return workers().submit([this, table = std::move(table), fields = std::move(fields),
+                             filter = std::move(filter)]() mutable
+    {
+      return select(std::move(table), std::move(fields), std::move(filter));
+    });
+  }
+
+  std::future<bool> insertAsync(std::string table, Fields fields, Values values)
+  {
+    return workers().submit([this, table = std::move(table), fields = std::move(fields),
+                             values = std::move(values)]() mutable
+    {
+      return insert(std::move(table), std::move(fields), std::move(values));
+    });
+  }
+
+  std::future<std::string> insertAsync(std::string table, Fields fields, Values values, std::string returning)
+  {
+    return workers().submit([this, table = std::move(table), fields = std::move(fields),
+                             values = std::move(values), returning = std::move(returning)]() mutable
+    {
+      return insert(std::move(table), std::move(fields), std::move(values), std::move(returning));
+    });
+  }
+
+  std::future<std::string> updateAsync(std::string table, Fields fields, Values values,
+                                       QueryFilter filter, std::string returning = "id")
+  {
+    return workers().submit([this, table = std::move(table), fields = std::move(fields),
+                             values = std::move(values), filter = std::move(filter),
+                             returning = std::move(returning)]() mutable
+    {
+      return update(std::move(table), std::move(fields), std::move(values), std::move(filter), std::move(returning));
+    });
+  }
+
+  std::future<std::string> removeAsync(std::string table, QueryFilter filter)
+  {
+    return workers().submit([this, table = std::move(table), filter = std::move(filter)]() mutable
+    {
+      return remove(std::move(table), std::move(filter));
+    });
+  }
+
  private:
-  std::unique_ptr<db_cxn> m_connection;
-  identification          m_credentials;
+  using buffers = std::unordered_map<std::string, std::unique_ptr<WriteBuffer>>;
+
+  static KDB& drained(KDB& k)
+  {
+    std::lock_guard<std::mutex> lock(k.m_workers_mutex);
+    k.m_workers.reset();
+    return k;
+  }
+
+  thread_pool& workers()
+  {
+    std::lock_guard<std::mutex> lock(m_workers_mutex);
+    if (!m_workers)
+      m_workers = std::make_unique<thread_pool>(m_async_workers);
+    return *m_workers;
+  }
+
+  std::unique_ptr<db_cxn>      m_connection;
+  identification               m_credentials;
+  size_t                       m_async_workers;
+  std::mutex                   m_workers_mutex;
+  std::mutex                   m_buffers_mutex;
+  buffers                      m_buffers; // flushed before the connection goes
+  std::unique_ptr<thread_pool> m_workers; // declared last so queued work finishes before the connection goes
 };
 
 }  // namespace kdb
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "db_structs.hpp"
+#include <chrono>
+#include <string_view>
+
+namespace kdb
+{
+enum class QueryPhase
+{
+  CONNECT = 0,
+  BUILD   = 1,
+  EXECUTE = 2,
+  COMMIT  = 3,
+  CONVERT = 4
+};
+
+inline constexpr size_t QUERY_PHASES = 5;
+
+struct QueryEvent
+{
+  QueryPhase               phase;
+  QueryType                type;
+  std::string_view         table;
+  std::chrono::nanoseconds elapsed;
+  size_t                   rows;   // set for EXECUTE and CONVERT
+  size_t                   bytes;  // result payload, set for EXECUTE
+};
+
+/**
+ * Receives the timing of each phase of every statement db_cxn runs. Calls arrive on
+ * the thread that ran the statement, so implementations must be thread-safe. With no
+ * observer installed, db_cxn skips the timing entirely.
+ */
+class QueryObserver {
+public:
+  virtual ~QueryObserver() {}
+  virtual void on_phase(const QueryEvent& event) = 0;
+};
+
+inline const char* phase_name(QueryPhase phase)
+{
+  switch (phase)
+  {
+    case QueryPhase::CONNECT: return "connect";
+    case QueryPhase::BUILD:   return "build";
+    case QueryPhase::EXECUTE: return "execute";
+    case QueryPhase::COMMIT:  return "commit";
+    case QueryPhase::CONVERT: return "convert";
+  }
+  return "unknown";
+}
+
+inline const char* type_name(QueryType type)
+{
+  switch (type)
+  {
+    case QueryType::INSERT: return "insert";
+    case QueryType::DELETE: return "delete";
+    case QueryType::UPDATE: return "update";
+    case QueryType::SELECT: return "select";
+  }
+  return "unknown";
+}
+} // ns kdb
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "database_connection.hpp"
+#include "db_structs.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace kdb
+{
+std::string encode_token(const StringVec& values);
+StringVec   decode_token(const std::string& token);
+
+struct Page
+{
+  QueryValues rows;
+  std::string token; // pass to Pager::page() for the next page; empty only on the last page
+
+  bool more() const { return !token.empty(); }
+};
+//----------------------------------------------------
+/**
+ * Keyset pagination over a select. Pages are ordered by `keys`, whose last column must be
+ * unique (usually the primary key), and each page continues from the key values of the
+ * previous one instead of an offset, so deep pages cost the same as the first.
+ *
+ * Every page is an independent statement; nothing is held open between pages. The token
+ * carries the position, so a page can be resumed from another Pager or process. Keys
+ * are matched to the selected fields by their full name, e.g. tasks.id in a join, and
+ * selected as well when missing. Key columns must not be NULL: a page holding a row with
+ * a NULL key throws std::invalid_argument rather than returning a token that would skip
+ * or repeat rows.
+ */
+template <typename Q>
+class Pager {
+public:
+  Pager(db_cxn& db, Q query, Fields keys, size_t size, bool descending = false)
+  : m_db(db)
+  {
+    if (keys.empty() || !size)
+      throw std::invalid_argument{"Pager needs at least one key and a page size"};
+
+    m_query.table  = query.table;
+    m_query.fields = query.fields;
+    for (const auto& key : keys)
+      if (std::find(m_query.fields.begin(), m_query.fields.end(), key) == m_query.fields.end())
+        m_query.fields.push_back(key);
+    m_query.query      = std::move(query);
+    m_query.keys       = std::move(keys);
+    m_query.descending = descending;
+    m_query.size       = size;
+  }
+
+  Page page(const std::string& token = "")
+  {
+    KeysetQuery<Q> query = m_query;
+    if (!token.empty())
+    {
+      query.after = decode_token(token);
+      if (query.after.size() != query.keys.size())
+        throw std::invalid_argument{"Continuation token does not match the pager's keys"};
+    }
+
+    Page page{m_db.query(std::move(query)).values, ""};
+    for (auto& row : page.rows)
+    {
+      const auto it = row.find(KEY_NULL_FIELD);
+      if (it == row.end() || it->second != "f")
+        throw std::invalid_argument{"Keyset pagination over a row whose key is NULL"};
+      row.erase(it);
+    }
+    if (page.rows.size() > m_query.size)
+    {
+      page.rows.pop_back();
+      StringVec last;
+      last.reserve(m_query.keys.size());
+      for (const auto& key : m_query.keys)
+        last.push_back(page.rows.back().at(key));
+      page.token = encode_token(last);
+    }
+    return page;
+  }
+
+  Page next()
+  {
+    Page current = page(m_token);
+    m_token = current.token;
+    m_done  = !current.more();
+    return current;
+  }
+
+  bool               done()  const { return m_done;  }
+  const std::string& token() const { return m_token; }
+
+private:
+  db_cxn&        m_db;
+  KeysetQuery<Q> m_query;
+  std::string    m_token;
+  bool           m_done{false};
+};
+} // ns kdb
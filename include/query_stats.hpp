@@ -0,0 +1,81 @@
+#pragma once
+
+#include "observer.hpp"
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+
+namespace kdb
+{
+/**
+ * Log-linear latency histogram in the style of HdrHistogram: 16 linear sub-buckets per
+ * power of two, so any recorded value is reported within ~6%. Recording is a handful of
+ * relaxed atomic increments and never allocates.
+ */
+class LatencyHistogram {
+public:
+  static constexpr size_t SUB_BITS = 4;
+  static constexpr size_t SUB      = size_t{1} << SUB_BITS;
+  static constexpr size_t BUCKETS  = SUB + (41 - SUB_BITS) * SUB; // up to 2^41 ns, about 36 minutes
+
+  void     record(uint64_t ns);
+  uint64_t count()                 const { return m_count.load(std::memory_order_relaxed); }
+  uint64_t sum()                   const { return m_sum  .load(std::memory_order_relaxed); }
+  uint64_t max()                   const { return m_max  .load(std::memory_order_relaxed); }
+  uint64_t percentile(double p)    const;
+
+private:
+  static size_t   bucket(uint64_t ns);
+  static uint64_t upper_bound(size_t bucket);
+
+  std::array<std::atomic<uint64_t>, BUCKETS> m_buckets{};
+  std::atomic<uint64_t>                      m_count{0};
+  std::atomic<uint64_t>                      m_sum{0};
+  std::atomic<uint64_t>                      m_max{0};
+};
+//----------------------------------------------------
+/**
+ * Built-in QueryObserver. Keeps one histogram per phase plus row and byte counters for
+ * every table and query type, and dumps them as Prometheus text or JSON.
+ */
+class QueryStats : public QueryObserver {
+public:
+  void        on_phase(const QueryEvent& event) override;
+
+  std::string prometheus() const;
+  std::string json()       const;
+  bool        write_prometheus(const std::string& path) const;
+  bool        write_json(const std::string& path)       const;
+
+private:
+  struct Series
+  {
+    std::array<LatencyHistogram, QUERY_PHASES> phases;
+    std::atomic<uint64_t>                      rows{0};
+    std::atomic<uint64_t>                      bytes{0};
+  };
+
+  using Key = std::pair<std::string, QueryType>;
+
+  struct KeyLess
+  {
+    using is_transparent = void;
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const
+    {
+      return std::pair<std::string_view, QueryType>{a.first, a.second} <
+             std::pair<std::string_view, QueryType>{b.first, b.second};
+    }
+  };
+
+  Series& series(std::string_view table, QueryType type);
+
+  std::map<Key, std::unique_ptr<Series>, KeyLess> m_series;
+  mutable std::shared_mutex                           m_mutex;
+};
+} // ns kdb
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "db_structs.hpp"
+#include "helpers.hpp"
+#include "results.hpp"
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct pg_conn;
+struct pg_result;
+
+namespace kdb
+{
+/**
+ * Runs queries on several libpq connections in non-blocking mode from one thread. Each
+ * query is sent with PQsendQueryParams on an idle connection and its completion is
+ * delivered from poll() once PQconsumeInput has read the whole result, so any number
+ * of queries can be outstanding without a thread each. Queries beyond the number of
+ * connections wait in FIFO order.
+ *
+ * Not thread-safe: submit and poll from the loop thread. fd() is an epoll descriptor
+ * that turns readable when poll() has work, for nesting in another event loop.
+ * Each query runs in its own implicit transaction. With `prepare` values are sent as
+ * $n parameters, as with dbconfig::prepare, instead of quoted into the statement.
+ * KDB::openReactor() opens one over the configured database.
+ */
+class reactor {
+public:
+  using Completion       = std::function<void(BatchResult result, std::exception_ptr error)>;
+  using SelectCompletion = std::function<void(QueryValues values, std::exception_ptr error)>;
+
+  reactor(const std::string& connection_string, size_t connections, bool prepare = false);
+  reactor(const reactor& r) = delete;
+  ~reactor();
+
+  void   submit(BatchQuery query, Completion done);
+  template <typename T>
+  void   select(T query, SelectCompletion done);
+
+  size_t poll(int timeout_ms = -1);
+  void   run();
+  int    fd()      const { return m_epoll;                        }
+  size_t pending() const { return m_queue.size() + m_in_flight; }
+
+private:
+  struct operation
+  {
+    std::string                                                sql;
+    StringVec                                                  params;
+    std::function<void(const pg_result*, std::exception_ptr)> done;
+  };
+
+  struct slot
+  {
+    pg_conn*                              connection{nullptr};
+    std::unique_ptr<operation>            current;
+    pg_result*                            result{nullptr};
+    bool                                  writing{false};
+    std::chrono::steady_clock::time_point retry{}; // earliest reconnect after a failed reset
+  };
+
+  static constexpr std::chrono::seconds RETRY_INTERVAL{1};
+
+  void enqueue(operation op);
+  void dispatch();
+  void send(slot& s);
+  void watch(slot& s, bool write);
+  void read(slot& s);
+  void fail(slot& s);
+  void reset(slot& s);
+  void finish(slot& s, std::exception_ptr error);
+
+  std::vector<slot>     m_slots;
+  std::deque<operation> m_queue;
+  size_t                m_in_flight{0};
+  size_t                m_completed{0};
+  int                   m_epoll{-1};
+  bool                  m_prepare;
+};
+//----------------------------------------------------
+template <typename T>
+void reactor::select(T query, SelectCompletion done)
+{
+  Binder    binder{m_prepare};
+  operation op{select_statement(query, binder), {}, {}};
+  Fields    fields = result_fields(query);
+  op.params = std::move(binder.values);
+  op.done   = [fields = std::move(fields), done = std::move(done)](const pg_result* result,
+                                                                   std::exception_ptr error)
+  {
+    if (error)
+      done(QueryValues{}, error);
+    else
+      done(to_values(result, fields), nullptr);
+  };
+  enqueue(std::move(op));
+}
+} // ns kdb
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "db_structs.hpp"
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace kdb
+{
+struct CacheStats
+{
+  uint64_t hits;
+  uint64_t misses;
+  size_t   entries;
+  size_t   bytes;
+};
+//----------------------------------------------------
+/**
+ * Select results keyed by their SQL text. Entries expire after the TTL of their table
+ * and the least recently used ones are dropped once max_bytes is exceeded. Writing to a
+ * table invalidates every entry that read from it.
+ *
+ * A fill is only stored if no invalidation happened since its epoch() was taken, so a
+ * select racing a write never caches the pre-write rows.
+ */
+class ResultCache {
+public:
+  using clock = std::chrono::steady_clock;
+
+  explicit ResultCache(cacheconfig config);
+
+  std::optional<QueryValues> get(const std::string& key);
+  void                       put(std::string key, const std::vector<std::string>& tables,
+                                 const QueryValues& values, uint64_t epoch);
+  void                       invalidate(const std::string& table);
+  void                       clear();
+
+  bool                       cacheable(const std::vector<std::string>& tables) const;
+  uint64_t                   epoch() const { return m_epoch.load(std::memory_order_acquire); }
+  CacheStats                 stats() const;
+
+private:
+  struct entry
+  {
+    std::string              key;
+    std::vector<std::string> tables;
+    QueryValues              values;
+    clock::time_point        expires;
+    size_t                   bytes;
+  };
+
+  using entries = std::list<entry>;
+
+  std::chrono::milliseconds ttl(const std::vector<std::string>& tables) const;
+  void                      erase(entries::iterator it);
+
+  cacheconfig                                                      m_config;
+  entries                                                          m_lru;   // most recently used first
+  std::unordered_map<std::string, entries::iterator>               m_index;
+  std::unordered_map<std::string, std::unordered_set<std::string>> m_tables; // table -> keys that read it
+  size_t                                                           m_bytes{0};
+  std::atomic<uint64_t>                                            m_epoch{0};
+  std::atomic<uint64_t>                                            m_hits{0};
+  std::atomic<uint64_t>                                            m_misses{0};
+  mutable std::mutex                                               m_mutex;
+};
+} // ns kdb
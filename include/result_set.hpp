@@ -0,0 +1,93 @@
+#pragma once
+
+#include "binary.hpp"
+#include "db_structs.hpp"
+#include "thread_pool.hpp"
+#include <pqxx/pqxx>
+#include <string_view>
+#include <unordered_map>
+
+namespace kdb
+{
+/**
+ * Columnar alternative to QueryValues. Column names are stored once and every value
+ * of every row lives in one contiguous arena, addressed by offset. Values are read as
+ * string_views by column index or name, both in constant time.
+ *
+ * A set filled from a binary result holds the raw wire bytes; as<T>() decodes either
+ * form, so callers that only use as<T>() work the same in both modes.
+ */
+class ResultSet {
+public:
+  class Row {
+  public:
+    Row(const ResultSet* set, size_t row) : m_set(set), m_row(row) {}
+
+    std::string_view operator[](size_t column)             const { return m_set->value(m_row, column);              }
+    std::string_view operator[](const std::string& column) const { return m_set->value(m_row, m_set->column(column)); }
+    bool             is_null(size_t column)                const { return m_set->is_null(m_row, column);            }
+    size_t           size()                                const { return m_set->columns();                         }
+
+    template <typename T>
+    T                as(size_t column)                     const { return m_set->as<T>(m_row, column);              }
+    template <typename T>
+    T                as(const std::string& column)         const { return m_set->as<T>(m_row, m_set->column(column)); }
+
+  private:
+    const ResultSet* m_set;
+    size_t           m_row;
+  };
+//----------------------------------------------------
+  class iterator {
+  public:
+    iterator(const ResultSet* set, size_t row) : m_set(set), m_row(row) {}
+
+    Row       operator*()                     const { return Row{m_set, m_row};  }
+    iterator& operator++()                          { m_row++; return *this;     }
+    bool      operator!=(const iterator& other) const { return m_row != other.m_row; }
+    bool      operator==(const iterator& other) const { return m_row == other.m_row; }
+
+  private:
+    const ResultSet* m_set;
+    size_t           m_row;
+  };
+//----------------------------------------------------
+  ResultSet() = default;
+  explicit ResultSet(Fields names);
+  ResultSet(const pqxx::result& result, Fields names, bool binary = false, thread_pool* pool = nullptr);
+
+  void             reserve(size_t rows, size_t bytes);
+  void             append(std::string_view value);
+  void             append_null();
+
+  size_t           rows()                                 const;
+  size_t           columns()                              const { return m_names.size(); }
+  bool             empty()                                const { return !rows();        }
+  const Fields&    names()                                const { return m_names;        }
+  size_t           column(const std::string& name)        const;
+  std::string_view value(size_t row, size_t column)       const;
+  bool             is_null(size_t row, size_t column)     const;
+  size_t           bytes()                                const;
+  bool             binary()                               const { return m_binary;       }
+
+  template <typename T>
+  T as(size_t row, size_t column) const
+  {
+    return (m_binary) ? decode_binary<T>(value(row, column), is_null(row, column), m_types[column]) :
+                        decode_text<T>  (value(row, column), is_null(row, column));
+  }
+
+  Row              operator[](size_t row)                 const { return Row{this, row};          }
+  iterator         begin()                                const { return iterator{this, 0};       }
+  iterator         end()                                  const { return iterator{this, rows()};  }
+
+private:
+  Fields                                  m_names;
+  std::unordered_map<std::string, size_t> m_index;
+  std::string                             m_arena;
+  std::vector<size_t>                     m_offsets{0}; // value i spans [m_offsets[i], m_offsets[i + 1])
+  std::vector<uint8_t>                    m_nulls;   // a byte per value, so chunks can be filled in parallel
+  std::vector<pqxx::oid>                  m_types;   // column types, kept for binary decoding
+  bool                                    m_binary{false};
+};
+} // ns kdb
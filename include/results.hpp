@@ -0,0 +1,103 @@
+#pragma once
+
+#include <db_structs.hpp>
+#include <thread_pool.hpp>
+#include <pqxx/pqxx>
+#include <algorithm>
+#include <string>
+
+struct pg_result;
+
+namespace kdb
+{
+/**
+ * The conversion behind every to_values: row_at(i) gives a callable returning the C string
+ * in each column of row i, so pqxx and raw libpq results (reactor.cpp) map to fields alike.
+ * Rows are split across `pool` when given, each chunk filling its own slots of the output.
+ */
+template <typename RowAt>
+QueryValues convert_rows(size_t rows, size_t columns, const Fields& fields, RowAt&& row_at,
+                         thread_pool* pool = nullptr)
+{
+  QueryValues values(rows);
+  columns = std::min(columns, fields.size());
+  for_chunks(pool, rows, 0, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; i++)
+    {
+      ResultMap& result_map = values[i];
+      const auto cell       = row_at(i);
+      for (size_t column = 0; column < columns; column++)
+        result_map[fields[column]] = cell(column);
+    }
+  });
+  return values;
+}
+
+// Every value a DELETE returned, under `key`; the last one wins
+template <typename RowAt>
+QueryValues convert_deleted(size_t rows, size_t columns, const std::string& key, RowAt&& row_at)
+{
+  QueryValues values{ResultMap{}};
+  for (size_t i = 0; i < rows; i++)
+  {
+    const auto cell = row_at(i);
+    for (size_t column = 0; column < columns; column++)
+      values.front()[key] = cell(column);
+  }
+  return values;
+}
+//----------------------------------------------------
+inline auto pqxx_row_at(const pqxx::result& pqxx_result)
+{
+  return [&pqxx_result](size_t i)
+  {
+    return [row = pqxx_result[static_cast<pqxx::result::size_type>(i)]](size_t column)
+    {
+      return row[static_cast<pqxx::row::size_type>(column)].c_str();
+    };
+  };
+}
+
+inline QueryValues to_values(const pqxx::result& pqxx_result, const Fields& fields, thread_pool* pool = nullptr)
+{
+  return convert_rows(pqxx_result.size(), pqxx_result.columns(), fields, pqxx_row_at(pqxx_result), pool);
+}
+
+inline QueryValues to_deleted(const pqxx::result& pqxx_result, const std::string& key)
+{
+  return convert_deleted(pqxx_result.size(), pqxx_result.columns(), key, pqxx_row_at(pqxx_result));
+}
+
+inline std::string first_value(const pqxx::result& pqxx_result)
+{
+  if (!pqxx_result.empty())
+  {
+    const auto row = pqxx_result.at(0);
+    if (!row.empty())
+      return row.at(0).as<std::string>();
+  }
+  return "";
+}
+//----------------------------------------------------
+// The same conversions for raw libpq results, as delivered by the reactor (reactor.cpp)
+QueryValues to_values(const pg_result* result, const Fields& fields);
+QueryValues to_deleted(const pg_result* result, const std::string& key);
+std::string first_value(const pg_result* result);
+//----------------------------------------------------
+template <typename R>
+BatchResult batch_result(const BatchQuery& query, const R& result)
+{
+  if (const auto* q = std::get_if<DatabaseQuery>(&query))
+  {
+    QueryResult converted{.table = q->table};
+    if (q->type == QueryType::SELECT)
+      converted.values = to_values(result, q->fields);
+    else
+    if (q->type == QueryType::DELETE && !q->filter.empty())
+      converted.values = to_deleted(result, q->filter.front().first);
+    return converted;
+  }
+  return first_value(result);
+}
+} // ns kdb
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "binary.hpp"
+#include "db_structs.hpp"
+#include "thread_pool.hpp"
+#include <pqxx/pqxx>
+#include <tuple>
+#include <type_traits>
+
+namespace kdb
+{
+template <typename Row, typename T>
+struct Column
+{
+  const char* name;
+  T Row::*    member;
+  using type = T;
+};
+
+template <typename Row, typename T>
+constexpr Column<Row, T> column(const char* name, T Row::* member)
+{
+  return Column<Row, T>{name, member};
+}
+
+/**
+ * Specialize for each struct to be selected directly, listing the columns in the order
+ * they are selected:
+ *
+ *   template <>
+ *   struct row_traits<Task>
+ *   {
+ *     static constexpr auto columns = std::make_tuple(column("id",   &Task::id),
+ *                                                     column("name", &Task::name));
+ *   };
+ *
+ * Members are parsed with pqxx::from_string<T>(), so std::optional members accept NULL;
+ * kdb::timestamp members are read from the ISO text form by parse_timestamp(). Binary
+ * results are decoded by decode_binary() instead.
+ */
+template <typename Row>
+struct row_traits;
+
+template <typename Row, typename = void>
+struct is_row : std::false_type {};
+
+template <typename Row>
+struct is_row<Row, std::void_t<decltype(row_traits<Row>::columns)>> : std::true_type {};
+
+template <typename Row>
+using IsRow = std::enable_if_t<is_row<Row>::value>;
+//----------------------------------------------------
+template <typename Row>
+Fields row_fields()
+{
+  return std::apply([](const auto&... columns) { return Fields{columns.name...}; }, row_traits<Row>::columns);
+}
+//----------------------------------------------------
+template <typename Row>
+Row decode_row(const pqxx::row& row, bool binary = false)
+{
+  Row out{};
+  std::apply([&](const auto&... columns)
+  {
+    pqxx::row::size_type i{};
+    const auto decode = [&](const auto& column)
+    {
+      using T = typename std::decay_t<decltype(column)>::type;
+      const pqxx::field      field = row[i++];
+      const std::string_view bytes{field.c_str(), field.size()};
+      return (binary) ? decode_binary<T>(bytes, field.is_null(), field.type()) :
+                        decode_text<T>  (bytes, field.is_null());
+    };
+    ((out.*(columns.member) = decode(columns)), ...);
+  }, row_traits<Row>::columns);
+  return out;
+}
+//----------------------------------------------------
+template <typename Row>
+std::vector<Row> decode_rows(const pqxx::result& result, bool binary = false, thread_pool* pool = nullptr)
+{
+  std::vector<Row> rows(result.size());
+  for_chunks(pool, rows.size(), 0, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; i++)
+      rows[i] = decode_row<Row>(result[static_cast<pqxx::result::size_type>(i)], binary);
+  });
+  return rows;
+}
+} // ns kdb
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace kdb
+{
+class thread_pool {
+public:
+  explicit thread_pool(size_t threads);
+  thread_pool(const thread_pool& p) = delete;
+  ~thread_pool();
+
+  template <typename F>
+  std::future<std::invoke_result_t<F>> submit(F&& f)
+  {
+    using R   = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    auto fut  = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_tasks.emplace_back([task] { (*task)(); });
+    }
+    m_ready.notify_one();
+    return fut;
+  }
+
+  size_t size() const { return m_threads.size(); }
+
+private:
+  void run();
+
+  std::vector<std::thread>          m_threads;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex                        m_mutex;
+  std::condition_variable           m_ready;
+  bool                              m_stop{false};
+};
+//----------------------------------------------------
+/**
+ * Calls fn(first, last) for every chunk of [0, count), on the calling thread and on up
+ * to `helpers` workers of `pool`. A chunk of 0 splits the range four ways per thread.
+ * The caller takes chunks too and only waits for those already running elsewhere, so
+ * it is safe to call from one of the pool's own workers. Without a pool, or with one
+ * chunk, everything runs on the caller. The first exception is rethrown once every
+ * chunk is done.
+ */
+template <typename F>
+void for_chunks(thread_pool* pool, size_t count, size_t chunk, F&& fn,
+                size_t helpers = std::numeric_limits<size_t>::max())
+{
+  if (!count)
+    return;
+
+  if (!chunk)
+    chunk = std::max<size_t>(1, count / (((pool) ? pool->size() + 1 : 1) * 4));
+  const size_t chunks = (count + chunk - 1) / chunk;
+  if (!pool || chunks == 1 || !helpers)
+  {
+    for (size_t first = 0; first < count; first += chunk)
+      fn(first, std::min(count, first + chunk));
+    return;
+  }
+
+  struct chunks_state
+  {
+    std::atomic<size_t>     next{0};
+    size_t                  done{0};
+    std::exception_ptr      error;
+    std::mutex              mutex;
+    std::condition_variable finished;
+  };
+
+  // Helpers that start after every chunk was taken return without touching fn
+  auto       state = std::make_shared<chunks_state>();
+  const auto take  = [&fn, state, count, chunk, chunks]
+  {
+    for (size_t i = state->next++; i < chunks; i = state->next++)
+    {
+      try
+      {
+        fn(i * chunk, std::min(count, (i + 1) * chunk));
+      }
+      catch (...)
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->error)
+          state->error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (++state->done == chunks)
+        state->finished.notify_all();
+    }
+  };
+
+  for (size_t i = 0, n = std::min({chunks - 1, pool->size(), helpers}); i < n; i++)
+    pool->submit(take);
+
+  take();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->finished.wait(lock, [&] { return state->done == chunks; });
+  if (state->error)
+    std::rethrow_exception(state->error);
+}
+} // ns kdb
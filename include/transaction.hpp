@@ -0,0 +1,46 @@
+#pragma once
+
+#include "connection_pool.hpp"
+#include "db_structs.hpp"
+#include <pqxx/pqxx>
+
+namespace kdb
+{
+class db_cxn;
+struct Binder;
+
+/**
+ * Runs several statements on one pooled connection inside a single transaction, which
+ * is committed once. Destroying an uncommitted Transaction rolls it back.
+ */
+class Transaction {
+public:
+  Transaction(db_cxn& db, connection_pool::lease cxn);
+  Transaction(const Transaction& t) = delete;
+  ~Transaction() = default;
+
+  QueryValues select(const std::string& table, const Fields& fields, const QueryFilter& filter = {});
+  bool        insert(const std::string& table, const Fields& fields, const Values& values);
+  std::string insert(const std::string& table, const Fields& fields, const Values& values,
+                     const std::string& returning);
+  std::string update(const std::string& table, const Fields& fields, const Values& values,
+                     const QueryFilter& filter, const std::string& returning = "id");
+  std::string remove(const std::string& table, const QueryFilter& filter);
+
+  void        savepoint  (const std::string& name);
+  void        rollback_to(const std::string& name);
+  void        release    (const std::string& name);
+
+  void        commit();
+  void        abort();
+
+private:
+  pqxx::result exec(const std::string& sql, const Binder& binder);
+  pqxx::result write(const std::string& table, const std::string& sql, const Binder& binder);
+
+  db_cxn&                  m_db;
+  connection_pool::lease   m_cxn;     // must outlive m_work
+  pqxx::work               m_work;
+  std::vector<std::string> m_written; // tables whose cached selects are dropped on commit
+};
+} // ns kdb
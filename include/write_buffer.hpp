@@ -0,0 +1,85 @@
+#pragma once
+
+#include "db_structs.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace kdb
+{
+class db_cxn;
+
+struct BufferStats
+{
+  uint64_t written;
+  uint64_t dropped;
+  uint64_t flushes;
+  uint64_t failures;
+  size_t   pending;
+};
+//----------------------------------------------------
+/**
+ * Write-behind for append-only tables. insert() queues a row and returns; a flusher
+ * thread writes everything queued as one multi-row insert, or COPY above the copy
+ * threshold, once max_rows or max_bytes is reached or interval has passed.
+ *
+ * Producers push onto a lock-free multi-producer queue; only the overflow policy and
+ * waking the flusher take a lock. Rows of a failed flush are handed to the error
+ * handler, or the error is kept and rethrown by the next flush() when there is none.
+ * The destructor flushes what is left.
+ */
+class WriteBuffer {
+public:
+  using ErrorHandler = std::function<void(const Values& rows, std::exception_ptr error)>;
+
+  WriteBuffer(db_cxn& db, std::string table, Fields fields, bufferconfig config = {});
+  WriteBuffer(const WriteBuffer& b) = delete;
+  ~WriteBuffer();
+
+  bool        insert(Values row);
+  void        flush();
+  void        on_error(ErrorHandler handler);
+  BufferStats stats() const;
+
+private:
+  struct node
+  {
+    std::atomic<node*> next{nullptr};
+    Values             row;
+    size_t             bytes{0};
+  };
+
+  void   push(node* n);
+  node*  pop();
+  void   run();
+  void   write();
+
+  db_cxn&                 m_db;
+  std::string             m_table;
+  Fields                  m_fields;
+  bufferconfig            m_config;
+  ErrorHandler            m_on_error;
+  std::exception_ptr      m_error;
+
+  node                    m_stub;
+  std::atomic<node*>      m_head{&m_stub}; // producers swap themselves in here
+  node*                   m_tail{&m_stub}; // owned by whoever holds m_write_mutex
+  std::atomic<size_t>     m_rows{0};
+  std::atomic<size_t>     m_bytes{0};
+  std::atomic<uint64_t>   m_written{0};
+  std::atomic<uint64_t>   m_dropped{0};
+  std::atomic<uint64_t>   m_flushes{0};
+  std::atomic<uint64_t>   m_failures{0};
+
+  std::mutex              m_write_mutex;   // one consumer at a time: the flusher or flush()
+  std::mutex              m_mutex;         // guards the wakeups below and m_on_error, m_error
+  std::condition_variable m_wake;
+  std::condition_variable m_room;
+  bool                    m_stop{false};
+  std::thread             m_flusher;       // started last, stopped first
+};
+} // ns kdb
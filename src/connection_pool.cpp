@@ -0,0 +1,185 @@
+#include <stdexcept>
+#include <utility>
+
+#include "connection_pool.hpp"
+
+namespace kdb
+{
+connection_pool::lease::lease(connection_pool* pool, entry e)
+: m_pool(pool),
+  m_entry(std::move(e))
+{}
+
+connection_pool::lease::lease(lease&& l)
+: m_pool(l.m_pool),
+  m_entry(std::move(l.m_entry))
+{
+  l.m_pool = nullptr;
+}
+
+connection_pool::lease::~lease()
+{
+  if (m_pool && m_entry.connection)
+    m_pool->release(std::move(m_entry));
+}
+//----------------------------------------------------
+connection_pool::connection_pool(std::string connection_string, poolconfig config)
+: m_connection_string(std::move(connection_string)),
+  m_config(config)
+{
+  if (!m_config.max_size)
+    m_config.max_size = 1;
+  if (m_config.min_size > m_config.max_size)
+    m_config.min_size = m_config.max_size;
+
+  for (size_t i = 0; i < m_config.min_size; i++)
+  {
+    m_idle.push_back(open());
+    m_total++;
+  }
+}
+//----------------------------------------------------
+connection_pool::lease connection_pool::acquire()
+{
+  const auto                   deadline = clock::now() + m_config.acquire_timeout;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (auto evicted = evict(clock::now()); !evicted.empty())
+  {
+    lock.unlock();
+    evicted.clear();
+    lock.lock();
+  }
+
+  for (;;)
+  {
+    while (!m_idle.empty())
+    {
+      entry e = take_idle();
+      lock.unlock();
+      if (healthy(e))
+      {
+        e.owner = std::this_thread::get_id();
+        return lease{this, std::move(e)};
+      }
+
+      e.connection.reset();
+      lock.lock();
+      m_total--;
+    }
+
+    if (m_total < m_config.max_size)
+    {
+      m_total++;
+      lock.unlock();
+      try
+      {
+        entry e = open();
+        e.owner = std::this_thread::get_id();
+        return lease{this, std::move(e)};
+      }
+      catch (...)
+      {
+        lock.lock();
+        m_total--;
+        m_available.notify_one();
+        throw;
+      }
+    }
+
+    if (m_available.wait_until(lock, deadline) == std::cv_status::timeout && m_idle.empty() &&
+        m_total >= m_config.max_size)
+      throw std::runtime_error{"kdb connection pool exhausted: no connection available within timeout"};
+  }
+}
+//----------------------------------------------------
+/**
+ * Prefers the idle connection this thread used last, then the most recently used one.
+ * Either way the deque stays ordered by last use, so evict() can keep trimming the tail.
+ */
+connection_pool::entry connection_pool::take_idle()
+{
+  const auto self = std::this_thread::get_id();
+  auto       it   = m_idle.begin();
+  while (it != m_idle.end() && it->owner != self)
+    ++it;
+  if (it == m_idle.end())
+    it = m_idle.begin();
+
+  entry e = std::move(*it);
+  m_idle.erase(it);
+  return e;
+}
+//----------------------------------------------------
+void connection_pool::release(entry e)
+{
+  const auto         now = clock::now();
+  std::vector<entry> evicted; // closed on return, after unlocking, as is a dead `e`
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (e.connection->is_open())
+    {
+      e.last_used = now;
+      m_idle.push_front(std::move(e)); // most recently used first, so the tail ages out
+    }
+    else
+      m_total--;
+
+    evicted = evict(now);
+  }
+  m_available.notify_one();
+}
+//----------------------------------------------------
+connection_pool::entry connection_pool::open()
+{
+  return entry{std::make_unique<pqxx::connection>(m_connection_string), clock::now(), {}, {}};
+}
+//----------------------------------------------------
+bool connection_pool::healthy(entry& e) const
+{
+  if (!e.connection->is_open())
+    return false;
+
+  if (clock::now() - e.last_used < m_config.health_check)
+    return true;
+
+  try
+  {
+    pqxx::nontransaction{*e.connection}.exec("SELECT 1");
+    return true;
+  }
+  catch (const std::exception&)
+  {
+    return false;
+  }
+}
+//----------------------------------------------------
+/**
+ * Takes idle connections above min_size out of the pool once they have been unused for
+ * idle_timeout. The caller closes them after unlocking, so acquire() never waits on a
+ * connection being torn down.
+ */
+std::vector<connection_pool::entry> connection_pool::evict(clock::time_point now)
+{
+  std::vector<entry> evicted;
+  while (m_total > m_config.min_size && !m_idle.empty() &&
+         now - m_idle.back().last_used > m_config.idle_timeout)
+  {
+    evicted.push_back(std::move(m_idle.back()));
+    m_idle.pop_back();
+    m_total--;
+  }
+  return evicted;
+}
+//----------------------------------------------------
+size_t connection_pool::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_total;
+}
+//----------------------------------------------------
+size_t connection_pool::idle() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_idle.size();
+}
+} // ns kdb
@@ -1,75 +1,150 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <pqxx/pqxx>
 #include <sstream>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <variant>
 
 #include "database_connection.hpp"
-#include "helpers.hpp"
+#include "reactor.hpp"
 
 namespace kdb
 {
 bool db_cxn::set_config(dbconfig config)
 {
-  m_config  = config;
-  m_db_name = config.credentials.name;
+  m_config     = config;
+  m_db_name    = config.credentials.name;
+  m_pool       = std::make_unique<connection_pool>(connection_string(), m_config.pool);
+  m_cache      = (m_config.cache.max_bytes) ? std::make_unique<ResultCache>(m_config.cache) : nullptr;
+  m_converters = (m_config.convert_threads > 1) ? std::make_unique<thread_pool>(m_config.convert_threads - 1)
+                                                : nullptr;
   return true;
 }
 
-pqxx::result db_cxn::do_insert(DatabaseQuery query)
+// Helpers for converting a result of `rows` rows, or none when it is small enough for the caller alone
+thread_pool* db_cxn::converters(size_t rows) const
 {
-  pqxx::connection connection(connection_string().c_str());
-  pqxx::work worker(connection);
-  pqxx::result pqxx_result = worker.exec(insert_statement(query));
-  worker.commit();
+  return (rows > m_config.convert_rows) ? m_converters.get() : nullptr;
+}
 
-  return pqxx_result;
+pqxx::result db_cxn::do_insert(const DatabaseQuery& query)
+{
+  return run(QueryType::INSERT, query.table, [&](Binder& binder) { return insert_statement(query, binder); });
 }
 
-pqxx::result db_cxn::do_insert(InsertReturnQuery query, std::string returning)
+pqxx::result db_cxn::do_insert(const InsertReturnQuery& query, const std::string& returning)
 {
-  std::string table = query.table;
-  pqxx::connection connection(connection_string().c_str());
-  pqxx::work worker(connection);
-  pqxx::result pqxx_result = worker.exec(insert_statement(query, returning));
-  worker.commit();
+  return run(QueryType::INSERT, query.table, [&](Binder& binder)
+  {
+    return insert_statement(query, returning, binder);
+  });
+}
 
-  return pqxx_result;
+pqxx::result db_cxn::do_update(const UpdateReturnQuery& query, const std::string& returning)
+{
+  return run(QueryType::UPDATE, query.table, [&](Binder& binder)
+  {
+    return update_statement(query, returning, binder);
+  });
 }
 
-pqxx::result db_cxn::do_update(UpdateReturnQuery query, std::string returning)
+/**
+ * Streams the rows with COPY ... FROM STDIN. Values are written as-is, so there is no
+ * quoting and no statement for the server to parse. Empty values are written as the
+ * text NULL, matching the literal insert path.
+ */
+size_t db_cxn::do_copy(const DatabaseQuery& query)
 {
-  std::string table = query.table;
-  pqxx::connection connection(connection_string().c_str());
-  pqxx::work worker(connection);
-  pqxx::result pqxx_result = worker.exec(update_statement(query, returning));
-  worker.commit();
+  const size_t columns = query.fields.size();
+  if (!columns || query.values.size() % columns)
+    throw std::invalid_argument{"Bulk insert requires a value for every field of every row"};
+
+  const auto                    type = QueryType::INSERT;
+  auto                          cxn  = timed(QueryPhase::CONNECT, type, query.table, [this] { return connection(); });
+  pqxx::work                    worker(*cxn);
+  std::vector<std::string_view> row(columns);
 
-  return pqxx_result;
+  timed(QueryPhase::EXECUTE, type, query.table, [&]
+  {
+    auto stream = pqxx::stream_to::raw_table(worker, query.table, fields_string(query.fields));
+    for (size_t i = 0; i < query.values.size(); i += columns)
+    {
+      for (size_t j = 0; j < columns; j++)
+      {
+        const auto& value = query.values[i + j];
+        row[j] = (value.empty()) ? std::string_view{"NULL"} : std::string_view{value};
+      }
+      stream.write_row(row);
+    }
+    stream.complete();
+  });
+  timed(QueryPhase::COMMIT, type, query.table, [&] { worker.commit(); });
+
+  return query.values.size() / columns;
 }
 
-template <typename T>
-pqxx::result db_cxn::do_select(T query)
+/**
+ * Statements built with a preparing Binder carry their values as $n parameters. The
+ * text is then the query's shape, which is prepared once per connection and reused.
+ * Once a connection holds m_config.statements shapes, new ones run unnamed.
+ */
+pqxx::result db_cxn::exec(connection_pool::lease& cxn, pqxx::work& worker, const std::string& sql,
+                          const Binder& binder)
 {
-  pqxx::connection connection(connection_string().c_str());
-  pqxx::work worker(connection);
-  pqxx::result pqxx_result = worker.exec(select_statement(query));
-  worker.commit();
+  if (!binder.prepare)
+    return worker.exec(sql);
 
-  return pqxx_result;
+  pqxx::params params;
+  params.reserve(binder.values.size());
+  for (const auto& value : binder.values)
+    params.append(value);
+
+  auto& prepared = cxn.prepared();
+  auto  it       = prepared.find(sql);
+  if (it == prepared.end())
+  {
+    if (prepared.size() >= m_config.statements)
+      return worker.exec_params(sql, params);
+
+    const std::string name = "kdb_" + std::to_string(prepared.size());
+    cxn->prepare(name, sql);
+    it = prepared.emplace(sql, name).first;
+  }
+
+  return worker.exec_prepared(it->second, params);
 }
 
-template <typename T>
-pqxx::result db_cxn::do_delete(T query)
+/**
+ * pqxx only reads results as text, so binary results come through a BINARY cursor,
+ * which makes the server send every column in its binary format. The cursor lives
+ * until the surrounding transaction ends.
+ */
+pqxx::result db_cxn::exec_binary(pqxx::work& worker, const std::string& sql, const Binder& binder)
 {
-  pqxx::connection connection(connection_string().c_str());
-  pqxx::work worker(connection);
-  pqxx::result pqxx_result = worker.exec(delete_statement(query));
-  worker.commit();
+  const std::string declare = "DECLARE kdb_binary BINARY NO SCROLL CURSOR FOR " + sql;
+  if (binder.prepare)
+  {
+    pqxx::params params;
+    params.reserve(binder.values.size());
+    for (const auto& value : binder.values)
+      params.append(value);
+    worker.exec_params(declare, params);
+  }
+  else
+    worker.exec(declare);
+
+  return worker.exec("FETCH ALL FROM kdb_binary");
+}
 
-  return pqxx_result;
+connection_pool::lease db_cxn::connection()
+{
+  if (!m_pool)
+    throw std::logic_error{"kdb connection used before set_config"};
+  return m_pool->acquire();
 }
 
 std::string db_cxn::connection_string()
@@ -96,46 +171,35 @@ QueryResult db_cxn::query(DatabaseQuery query)
     {
       try
       {
-        pqxx::result pqxx_result = do_insert(query);
+        if (m_config.copy_threshold && !query.fields.empty() &&
+            query.values.size() / query.fields.size() > m_config.copy_threshold)
+          do_copy(query);
+        else
+          do_insert(query);
+        invalidate(query.table);
         return QueryResult{};
       }
       catch (const pqxx::sql_error &e)
       {
         std::cerr << e.what() << "\n" << e.query() << std::endl;
-        throw e;
+        throw;
       }
       catch (const std::exception &e)
       {
         std::cerr << e.what() << std::endl;
-        throw e;
+        throw;
       }
     }
     case QueryType::SELECT:
-    {
-      pqxx::result pqxx_result = do_select(query);
-      QueryResult result{.table = query.table};
-
-      for (const auto &row : pqxx_result)
-      {
-        ResultMap values;
-        int index = 0;
-        for (const auto &value : row)
-          values[query.fields[index++]] = value.c_str();
-        result.values.push_back(values);
-
-      }
-      return result;
-    }
+      return cached(query);
 
     case QueryType::DELETE:
     {
-      pqxx::result pqxx_result   = do_delete(query);
-      QueryResult  result{.table = query.table};
-      result.values.push_back(ResultMap{});
-      for (const auto &row : pqxx_result)
-        for (const auto &value : row)
-          result.values.front()[query.filter.value().front().first] = value.c_str();
-      return result;
+      pqxx::result pqxx_result = do_delete(query);
+      invalidate(query.table);
+      if (query.filter.empty())
+        return QueryResult{.table = query.table, .values = {}};
+      return QueryResult{.table = query.table, .values = to_deleted(pqxx_result, query.filter.front().first)};
     }
 
     case QueryType::UPDATE:
@@ -145,72 +209,158 @@ QueryResult db_cxn::query(DatabaseQuery query)
   return QueryResult{};
 }
 
-template <typename T>
-QueryResult db_cxn::query(T query)
+std::string db_cxn::query(InsertReturnQuery query)
 {
-  pqxx::result pqxx_result = do_select(query);
-  QueryResult result{.table = query.table};
-
-  for (const auto &row : pqxx_result)
-  {
-    int index{};
-    ResultMap values;
-    for (const auto &value : row)
-      values[query.fields[index++]] = value.c_str();
-    result.values.push_back(values);
-  }
-  return result;
+  const pqxx::result pqxx_result = do_insert(query, query.returning);
+  invalidate(query.table);
+  return first_value(pqxx_result);
 }
 
-template QueryResult db_cxn::query(
-  MultiVariantFilterSelect<std::vector<std::variant<CompFilter, CompBetweenFilter>>>);
-
-template QueryResult db_cxn::query(
-  MultiVariantFilterSelect<std::vector<std::variant<CompFilter, CompBetweenFilter, MultiOptionFilter>>>);
+std::string db_cxn::query(UpdateReturnQuery query)
+{
+  const pqxx::result pqxx_result = do_update(query, query.returning);
+  invalidate(query.table);
+  return first_value(pqxx_result);
+}
 
-template QueryResult db_cxn::query(
-  MultiVariantFilterSelect<std::vector<std::variant<CompBetweenFilter, QueryFilter>>>);
+/**
+ * Every statement is queued on one pqxx::pipeline inside a single transaction, so the
+ * whole batch costs one round trip and one commit. Results come back in queue order.
+ * Statements are sent as text, so values are inlined even when preparing is enabled.
+ */
+std::vector<BatchResult> db_cxn::execute(const std::vector<BatchQuery>& queries)
+{
+  std::vector<BatchResult>              results;
+  std::vector<pqxx::pipeline::query_id> ids;
+  auto                                  cxn = connection();
+  pqxx::work                            worker(*cxn);
+  pqxx::pipeline                        pipe(worker);
 
-template QueryResult db_cxn::query(
-  MultiVariantFilterSelect<std::vector<std::variant<QueryComparisonFilter, QueryFilter>>>);
+  results.reserve(queries.size());
+  ids    .reserve(queries.size());
+  pipe.retain(static_cast<int>(queries.size()));
 
-template QueryResult db_cxn::query(
-  JoinQuery<std::vector<std::variant<CompFilter, CompBetweenFilter>>>);
+  for (const auto& query : queries)
+  {
+    Binder binder{};
+    ids.push_back(pipe.insert(batch_statement(query, binder)));
+  }
 
-template QueryResult db_cxn::query(
-  JoinQuery<std::vector<QueryFilter>>);
+  for (size_t i = 0; i < queries.size(); i++)
+    results.emplace_back(batch_result(queries[i], pipe.retrieve(ids[i])));
 
-template QueryResult db_cxn::query(
-  JoinQuery<QueryFilter>);
+  pipe.complete();
+  worker.commit();
 
-template QueryResult db_cxn::query(
-  SimpleJoinQuery);
+  for (const auto& query : queries)
+    std::visit([this](const auto& q)
+    {
+      if (q.type != QueryType::SELECT)
+        invalidate(q.table);
+    }, query);
 
-template QueryResult db_cxn::query(
-  JoinQuery<std::vector<std::variant<CompFilter, CompBetweenFilter, MultiOptionFilter>>>);
+  return results;
+}
 
-template QueryResult db_cxn::query<ComparisonSelectQuery>(ComparisonSelectQuery);
+size_t db_cxn::bulk_insert(DatabaseQuery query)
+{
+  try
+  {
+    const size_t rows = do_copy(query);
+    invalidate(query.table);
+    return rows;
+  }
+  catch (const pqxx::sql_error &e)
+  {
+    std::cerr << e.what() << "\n" << e.query() << std::endl;
+    throw;
+  }
+}
 
-std::string db_cxn::query(InsertReturnQuery query)
+/**
+ * Rows are written in chunks of chunk_size, each one UPDATE ... FROM (VALUES ...), all in
+ * one transaction. With prepared statements a chunk also stays under the protocol's
+ * limit of 65535 parameters. Returns the keys of the rows that were updated.
+ */
+QueryValues db_cxn::bulk_update(const BulkUpdateQuery& query)
 {
-  if (const pqxx::result pqxx_result = do_insert(query, query.returning); !pqxx_result.empty())
+  const size_t width = query.keys.size() + query.fields.size();
+  if (query.keys.empty() || query.fields.empty() || query.values.size() % width)
+    throw std::invalid_argument{"bulk_update needs keys, fields and whole rows of values"};
+
+  const size_t rows  = query.values.size() / width;
+  size_t       chunk = (m_config.chunk_size) ? m_config.chunk_size : rows;
+  if (m_config.prepare)
+    chunk = std::min(chunk, size_t{65535} / width);
+
+  const auto        type  = QueryType::UPDATE;
+  auto              cxn   = timed(QueryPhase::CONNECT, type, query.table, [this] { return connection(); });
+  const ColumnTypes types = column_types(cxn, query.table);
+  pqxx::work        worker(*cxn);
+  QueryValues       keys;
+  keys.reserve(rows);
+
+  for (size_t row = 0; row < rows; row += chunk)
   {
-    const auto row = pqxx_result.at(0);
-    if (!row.empty())
-      return row.at(0).as<std::string>();
+    Binder             binder{m_config.prepare};
+    const std::string  sql         = bulk_update_statement(query, row, std::min(chunk, rows - row), types, binder);
+    const pqxx::result pqxx_result = timed(QueryPhase::EXECUTE, type, query.table,
+      [&] { return exec(cxn, worker, sql, binder); });
+    for (auto& value : to_values(pqxx_result, query.keys))
+      keys.emplace_back(std::move(value));
   }
-  return "";
+
+  timed(QueryPhase::COMMIT, type, query.table, [&] { worker.commit(); });
+  invalidate(query.table);
+  return keys;
 }
 
-std::string db_cxn::query(UpdateReturnQuery query)
+ColumnTypes db_cxn::column_types(connection_pool::lease& cxn, const std::string& table)
 {
-  if (const pqxx::result pqxx_result = do_update(query, query.returning); !pqxx_result.empty())
   {
-    const auto row = pqxx_result.at(0);
-    if (!row.empty())
-      return row.at(0).as<std::string>();
+    std::lock_guard<std::mutex> lock(m_column_types_mutex);
+    if (const auto it = m_column_types.find(table); it != m_column_types.end())
+      return it->second;
   }
-  return "";
+
+  ColumnTypes          types;
+  pqxx::nontransaction worker(*cxn);
+  const pqxx::result   pqxx_result = worker.exec_params(
+    "SELECT attname, format_type(atttypid, atttypmod) FROM pg_attribute "
+    "WHERE attrelid = $1::regclass AND attnum > 0 AND NOT attisdropped", table);
+  for (const auto& row : pqxx_result)
+    types.emplace(row[0].c_str(), row[1].c_str());
+
+  std::lock_guard<std::mutex> lock(m_column_types_mutex);
+  return m_column_types.emplace(table, std::move(types)).first->second;
+}
+
+std::unique_ptr<Transaction> db_cxn::begin()
+{
+  return std::make_unique<Transaction>(*this, connection());
+}
+
+std::unique_ptr<reactor> db_cxn::open_reactor()
+{
+  if (!m_pool)
+    throw std::logic_error{"kdb connection used before set_config"};
+  return std::make_unique<reactor>(connection_string(), m_config.reactor_size, m_config.prepare);
+}
+
+void db_cxn::set_observer(std::shared_ptr<QueryObserver> observer)
+{
+  std::atomic_store(&m_observer, std::move(observer));
+}
+
+void db_cxn::invalidate(const std::string& table)
+{
+  if (m_cache)
+    m_cache->invalidate(table);
+}
+
+CacheStats db_cxn::cache_stats() const
+{
+  return (m_cache) ? m_cache->stats() : CacheStats{};
 }
 
 std::string db_cxn::name() { return m_db_name; }
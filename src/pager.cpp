@@ -0,0 +1,76 @@
+#include <stdexcept>
+#include <string_view>
+
+#include "pager.hpp"
+
+namespace kdb
+{
+static const char* g_token_chars   = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+static const char  g_token_version = '1';
+//----------------------------------------------------
+/**
+ * A version character followed by the URL-safe base64 of the key values separated by
+ * NUL bytes, which PostgreSQL text values cannot contain. The version character keeps
+ * a token non-empty even when its only key is an empty string.
+ */
+std::string encode_token(const StringVec& values)
+{
+  std::string raw;
+  for (size_t i = 0; i < values.size(); i++)
+  {
+    if (i)
+      raw.push_back('\0');
+    raw += values[i];
+  }
+
+  std::string token{g_token_version};
+  token.reserve(1 + (raw.size() + 2) / 3 * 4);
+  uint32_t bits{};
+  int      count{};
+  for (const unsigned char c : raw)
+  {
+    bits   = (bits << 8) | c;
+    count += 8;
+    while (count >= 6)
+    {
+      count -= 6;
+      token.push_back(g_token_chars[(bits >> count) & 0x3F]);
+    }
+  }
+  if (count)
+    token.push_back(g_token_chars[(bits << (6 - count)) & 0x3F]);
+  return token;
+}
+//----------------------------------------------------
+StringVec decode_token(const std::string& token)
+{
+  if (token.empty() || token.front() != g_token_version)
+    throw std::invalid_argument{"Malformed continuation token"};
+
+  std::string raw;
+  raw.reserve(token.size() * 3 / 4);
+  uint32_t bits{};
+  int      count{};
+  for (const char c : std::string_view{token}.substr(1))
+  {
+    const char* pos = std::char_traits<char>::find(g_token_chars, 64, c);
+    if (!pos)
+      throw std::invalid_argument{"Malformed continuation token"};
+    bits   = (bits << 6) | static_cast<uint32_t>(pos - g_token_chars);
+    count += 6;
+    if (count >= 8)
+    {
+      count -= 8;
+      raw.push_back(static_cast<char>((bits >> count) & 0xFF));
+    }
+  }
+
+  StringVec values(1);
+  for (const char c : raw)
+    if (c == '\0')
+      values.emplace_back();
+    else
+      values.back().push_back(c);
+  return values;
+}
+} // ns kdb
@@ -0,0 +1,166 @@
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#include "query_stats.hpp"
+
+namespace kdb
+{
+size_t LatencyHistogram::bucket(uint64_t ns)
+{
+  if (ns < SUB)
+    return ns;
+
+  const size_t exponent = 63 - __builtin_clzll(ns);
+  const size_t index    = SUB + (exponent - SUB_BITS) * SUB + ((ns >> (exponent - SUB_BITS)) - SUB);
+  return (index < BUCKETS) ? index : BUCKETS - 1;
+}
+//----------------------------------------------------
+uint64_t LatencyHistogram::upper_bound(size_t bucket)
+{
+  if (bucket < SUB)
+    return bucket;
+
+  const size_t exponent = (bucket - SUB) / SUB + SUB_BITS;
+  const size_t offset   = (bucket - SUB) % SUB;
+  return ((SUB + offset + 1) << (exponent - SUB_BITS)) - 1;
+}
+//----------------------------------------------------
+void LatencyHistogram::record(uint64_t ns)
+{
+  m_buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1,  std::memory_order_relaxed);
+  m_sum  .fetch_add(ns, std::memory_order_relaxed);
+
+  uint64_t max = m_max.load(std::memory_order_relaxed);
+  while (ns > max && !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    ;
+}
+//----------------------------------------------------
+uint64_t LatencyHistogram::percentile(double p) const
+{
+  const uint64_t total = count();
+  if (!total)
+    return 0;
+
+  const uint64_t target = static_cast<uint64_t>(p * total + 0.5);
+  uint64_t       seen{};
+  for (size_t i = 0; i < BUCKETS; i++)
+  {
+    seen += m_buckets[i].load(std::memory_order_relaxed);
+    if (seen >= target && seen)
+      return std::min(upper_bound(i), max());
+  }
+  return max();
+}
+//----------------------------------------------------
+QueryStats::Series& QueryStats::series(std::string_view table, QueryType type)
+{
+  const std::pair<std::string_view, QueryType> key{table, type};
+  {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (const auto it = m_series.find(key); it != m_series.end())
+      return *it->second;
+  }
+
+  std::unique_lock<std::shared_mutex> lock(m_mutex);
+  auto& series = m_series[Key{std::string{table}, type}];
+  if (!series)
+    series = std::make_unique<Series>();
+  return *series;
+}
+//----------------------------------------------------
+void QueryStats::on_phase(const QueryEvent& event)
+{
+  auto& s = series(event.table, event.type);
+  s.phases[static_cast<size_t>(event.phase)].record(static_cast<uint64_t>(event.elapsed.count()));
+  if (event.phase == QueryPhase::EXECUTE)
+  {
+    s.rows .fetch_add(event.rows,  std::memory_order_relaxed);
+    s.bytes.fetch_add(event.bytes, std::memory_order_relaxed);
+  }
+}
+//----------------------------------------------------
+std::string QueryStats::prometheus() const
+{
+  static const double quantiles[] = {0.5, 0.95, 0.99};
+  std::ostringstream  latency, rows, bytes;
+
+  latency << "# TYPE kdb_query_phase_seconds summary\n";
+  rows    << "# TYPE kdb_query_rows_total counter\n";
+  bytes   << "# TYPE kdb_query_bytes_total counter\n";
+
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  for (const auto& [key, series] : m_series)
+  {
+    const std::string labels = "table=\"" + key.first + "\",type=\"" + type_name(key.second) + '"';
+    for (size_t i = 0; i < QUERY_PHASES; i++)
+    {
+      const auto& histogram = series->phases[i];
+      if (!histogram.count())
+        continue;
+
+      const std::string phase_labels = labels + ",phase=\"" + phase_name(static_cast<QueryPhase>(i)) + '"';
+      for (const double q : quantiles)
+        latency << "kdb_query_phase_seconds{" << phase_labels << ",quantile=\"" << q << "\"} "
+                << histogram.percentile(q) / 1e9 << '\n';
+      latency << "kdb_query_phase_seconds_sum{"   << phase_labels << "} " << histogram.sum() / 1e9 << '\n'
+              << "kdb_query_phase_seconds_count{" << phase_labels << "} " << histogram.count()     << '\n';
+    }
+    rows  << "kdb_query_rows_total{"  << labels << "} " << series->rows.load()  << '\n';
+    bytes << "kdb_query_bytes_total{" << labels << "} " << series->bytes.load() << '\n';
+  }
+
+  return latency.str() + rows.str() + bytes.str();
+}
+//----------------------------------------------------
+std::string QueryStats::json() const
+{
+  std::ostringstream os;
+  std::string_view   delim{};
+
+  os << "{\"series\":[";
+  std::shared_lock<std::shared_mutex> lock(m_mutex);
+  for (const auto& [key, series] : m_series)
+  {
+    std::string_view phase_delim{};
+    os << delim << "{\"table\":\"" << key.first << "\",\"type\":\"" << type_name(key.second)
+       << "\",\"rows\":" << series->rows.load() << ",\"bytes\":" << series->bytes.load() << ",\"phases\":{";
+    for (size_t i = 0; i < QUERY_PHASES; i++)
+    {
+      const auto& histogram = series->phases[i];
+      if (!histogram.count())
+        continue;
+
+      os << phase_delim << '"' << phase_name(static_cast<QueryPhase>(i)) << "\":{"
+         << "\"count\":"   << histogram.count()
+         << ",\"sum_ns\":" << histogram.sum()
+         << ",\"p50_ns\":" << histogram.percentile(0.5)
+         << ",\"p95_ns\":" << histogram.percentile(0.95)
+         << ",\"p99_ns\":" << histogram.percentile(0.99)
+         << ",\"max_ns\":" << histogram.max() << '}';
+      phase_delim = ",";
+    }
+    os << "}}";
+    delim = ",";
+  }
+  os << "]}";
+
+  return os.str();
+}
+//----------------------------------------------------
+bool QueryStats::write_prometheus(const std::string& path) const
+{
+  std::ofstream file{path};
+  file << prometheus();
+  return static_cast<bool>(file);
+}
+//----------------------------------------------------
+bool QueryStats::write_json(const std::string& path) const
+{
+  std::ofstream file{path};
+  file << json();
+  return static_cast<bool>(file);
+}
+} // ns kdb
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <cerrno>
+#include <libpq-fe.h>
+#include <pqxx/pqxx>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+#include "reactor.hpp"
+#include "helpers.hpp"
+#include "results.hpp"
+
+namespace kdb
+{
+static bool usable(PGconn* connection)
+{
+  return connection && PQstatus(connection) == CONNECTION_OK;
+}
+//----------------------------------------------------
+static void add_socket(int epoll, PGconn* connection, void* s)
+{
+  epoll_event event{};
+  event.events   = EPOLLIN;
+  event.data.ptr = s;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, PQsocket(connection), &event) < 0)
+    throw std::system_error{errno, std::generic_category(), "kdb reactor could not watch a connection"};
+}
+//----------------------------------------------------
+static auto pq_row_at(const PGresult* result)
+{
+  return [result](size_t i)
+  {
+    return [result, row = static_cast<int>(i)](size_t column)
+    {
+      return PQgetvalue(result, row, static_cast<int>(column));
+    };
+  };
+}
+//----------------------------------------------------
+QueryValues to_values(const PGresult* result, const Fields& fields)
+{
+  return convert_rows(PQntuples(result), PQnfields(result), fields, pq_row_at(result));
+}
+//----------------------------------------------------
+QueryValues to_deleted(const PGresult* result, const std::string& key)
+{
+  return convert_deleted(PQntuples(result), PQnfields(result), key, pq_row_at(result));
+}
+//----------------------------------------------------
+std::string first_value(const PGresult* result)
+{
+  if (PQntuples(result) && PQnfields(result))
+    return PQgetvalue(result, 0, 0);
+  return "";
+}
+//----------------------------------------------------
+reactor::reactor(const std::string& connection_string, size_t connections, bool prepare)
+: m_slots(std::max<size_t>(connections, 1)),
+  m_epoll(epoll_create1(EPOLL_CLOEXEC)),
+  m_prepare(prepare)
+{
+  if (m_epoll < 0)
+    throw std::system_error{errno, std::generic_category(), "kdb reactor could not create an epoll instance"};
+
+  try
+  {
+    for (auto& s : m_slots)
+    {
+      s.connection = PQconnectdb(connection_string.c_str());
+      if (!usable(s.connection))
+        throw pqxx::broken_connection{PQerrorMessage(s.connection)};
+      PQsetnonblocking(s.connection, 1);
+      add_socket(m_epoll, s.connection, &s);
+    }
+  }
+  catch (...)
+  {
+    for (auto& s : m_slots)
+      if (s.connection)
+        PQfinish(s.connection);
+    close(m_epoll);
+    throw;
+  }
+}
+//----------------------------------------------------
+reactor::~reactor()
+{
+  for (auto& s : m_slots)
+  {
+    if (s.result)
+      PQclear(s.result);
+    if (s.connection)
+      PQfinish(s.connection);
+  }
+  close(m_epoll);
+}
+//----------------------------------------------------
+void reactor::submit(BatchQuery query, Completion done)
+{
+  Binder    binder{m_prepare};
+  operation op{batch_statement(query, binder), {}, {}};
+  op.params = std::move(binder.values);
+  op.done   = [query = std::move(query), done = std::move(done)](const PGresult* result, std::exception_ptr error)
+  {
+    if (error)
+      done(BatchResult{}, error);
+    else
+      done(batch_result(query, result), nullptr);
+  };
+  enqueue(std::move(op));
+}
+//----------------------------------------------------
+void reactor::enqueue(operation op)
+{
+  m_queue.push_back(std::move(op));
+  dispatch();
+}
+//----------------------------------------------------
+/**
+ * Hands queued queries to idle connections. A connection that could not be
+ * re-established is retried here, blocking, at most once per RETRY_INTERVAL; while none
+ * is usable, queued queries fail rather than wait.
+ */
+void reactor::dispatch()
+{
+  bool any{false};
+  for (auto& s : m_slots)
+  {
+    if (!usable(s.connection) && std::chrono::steady_clock::now() >= s.retry)
+      reset(s);
+    if (!usable(s.connection))
+      continue;
+    any = true;
+    if (!s.current && !m_queue.empty())
+    {
+      s.current = std::make_unique<operation>(std::move(m_queue.front()));
+      m_queue.pop_front();
+      m_in_flight++;
+      send(s);
+    }
+  }
+
+  if (any)
+    return;
+
+  const auto error = std::make_exception_ptr(pqxx::broken_connection{"kdb reactor has no usable connection"});
+  while (!m_queue.empty())
+  {
+    operation op = std::move(m_queue.front());
+    m_queue.pop_front();
+    op.done(nullptr, error);
+  }
+}
+//----------------------------------------------------
+void reactor::send(slot& s)
+{
+  const auto&              op = *s.current;
+  std::vector<const char*> values;
+  values.reserve(op.params.size());
+  for (const auto& param : op.params)
+    values.push_back(param.c_str());
+
+  if (!PQsendQueryParams(s.connection, op.sql.c_str(), static_cast<int>(values.size()), nullptr, values.data(),
+                         nullptr, nullptr, 0))
+  {
+    fail(s);
+    return;
+  }
+
+  const int flushed = PQflush(s.connection);
+  if (flushed < 0)
+    fail(s);
+  else
+    watch(s, flushed == 1);
+}
+//----------------------------------------------------
+void reactor::watch(slot& s, bool write)
+{
+  if (s.writing == write)
+    return;
+
+  epoll_event event{};
+  event.events   = EPOLLIN | ((write) ? EPOLLOUT : 0);
+  event.data.ptr = &s;
+  epoll_ctl(m_epoll, EPOLL_CTL_MOD, PQsocket(s.connection), &event);
+  s.writing = write;
+}
+//----------------------------------------------------
+/**
+ * Reads whatever arrived without blocking and completes the slot's query once libpq
+ * has its whole result. A dropped connection fails the query in flight and is
+ * re-established, blocking, before the slot takes more work.
+ */
+void reactor::read(slot& s)
+{
+  if (!PQconsumeInput(s.connection))
+  {
+    fail(s);
+    return;
+  }
+
+  while (s.current && !PQisBusy(s.connection))
+  {
+    PGresult* result = PQgetResult(s.connection);
+    if (!result)
+    {
+      finish(s, nullptr);
+      return;
+    }
+    if (s.result)
+      PQclear(s.result);
+    s.result = result;
+  }
+
+  if (!s.current)
+    while (PGnotify* notify = PQnotifies(s.connection))
+      PQfreemem(notify);
+}
+//----------------------------------------------------
+/**
+ * Fails the slot's query, if any, with the connection's error and resets the connection,
+ * so whatever libpq still held of the failed send or result cannot surface as "another
+ * command is already in progress" on the next query.
+ */
+void reactor::fail(slot& s)
+{
+  const std::string error = PQerrorMessage(s.connection);
+  if (s.current)
+    finish(s, std::make_exception_ptr(pqxx::broken_connection{error}));
+  reset(s);
+}
+//----------------------------------------------------
+void reactor::reset(slot& s)
+{
+  epoll_ctl(m_epoll, EPOLL_CTL_DEL, PQsocket(s.connection), nullptr);
+  s.writing = false;
+  PQreset(s.connection);
+  if (!usable(s.connection))
+  {
+    s.retry = std::chrono::steady_clock::now() + RETRY_INTERVAL;
+    return;
+  }
+  PQsetnonblocking(s.connection, 1);
+  add_socket(m_epoll, s.connection, &s);
+}
+//----------------------------------------------------
+void reactor::finish(slot& s, std::exception_ptr error)
+{
+  const auto op     = std::move(s.current);
+  PGresult*  result = std::exchange(s.result, nullptr);
+  const std::unique_ptr<PGresult, decltype(&PQclear)> guard{result, &PQclear};
+  m_in_flight--;
+  m_completed++;
+
+  if (!error && !result)
+    error = std::make_exception_ptr(pqxx::failure{"kdb reactor query returned no result"});
+  else
+  if (!error && PQresultStatus(result) != PGRES_COMMAND_OK && PQresultStatus(result) != PGRES_TUPLES_OK)
+    error = std::make_exception_ptr(pqxx::sql_error{PQresultErrorMessage(result), op->sql});
+
+  op->done((error) ? nullptr : result, error);
+}
+//----------------------------------------------------
+size_t reactor::poll(int timeout_ms)
+{
+  dispatch();
+
+  epoll_event events[16];
+  const int   ready = epoll_wait(m_epoll, events, 16, timeout_ms);
+  if (ready < 0)
+  {
+    if (errno == EINTR)
+      return 0;
+    throw std::system_error{errno, std::generic_category(), "kdb reactor epoll_wait failed"};
+  }
+
+  const size_t completed = m_completed;
+  for (int i = 0; i < ready; i++)
+  {
+    slot& s = *static_cast<slot*>(events[i].data.ptr);
+    if (events[i].events & EPOLLOUT)
+    {
+      const int flushed = PQflush(s.connection);
+      if (flushed == 0)
+        watch(s, false);
+      else
+      if (flushed < 0)
+      {
+        fail(s);
+        continue;
+      }
+    }
+    if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+      read(s);
+  }
+
+  dispatch();
+  return m_completed - completed;
+}
+//----------------------------------------------------
+void reactor::run()
+{
+  while (pending())
+    poll();
+}
+} // ns kdb
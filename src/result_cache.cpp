@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#include "result_cache.hpp"
+
+namespace kdb
+{
+static size_t entry_bytes(const std::string& key, const QueryValues& values)
+{
+  size_t bytes = 128 + key.size();               // list node, index slot and table links
+  for (const auto& row : values)
+    for (const auto& [field, value] : row)
+      bytes += 64 + field.size() + value.size(); // map node per value
+  return bytes;
+}
+//----------------------------------------------------
+ResultCache::ResultCache(cacheconfig config)
+: m_config(std::move(config))
+{}
+//----------------------------------------------------
+std::chrono::milliseconds ResultCache::ttl(const std::vector<std::string>& tables) const
+{
+  auto ttl = m_config.ttl;
+  for (const auto& table : tables)
+    if (const auto it = m_config.tables.find(table); it != m_config.tables.end())
+      ttl = std::min(ttl, it->second);
+  return ttl;
+}
+//----------------------------------------------------
+bool ResultCache::cacheable(const std::vector<std::string>& tables) const
+{
+  return m_config.max_bytes && ttl(tables).count() > 0;
+}
+//----------------------------------------------------
+std::optional<QueryValues> ResultCache::get(const std::string& key)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = m_index.find(key);
+  if (it == m_index.end())
+  {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+
+  if (it->second->expires <= clock::now())
+  {
+    erase(it->second);
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return std::nullopt;
+  }
+
+  m_lru.splice(m_lru.begin(), m_lru, it->second);
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return it->second->values;
+}
+//----------------------------------------------------
+void ResultCache::put(std::string key, const std::vector<std::string>& tables, const QueryValues& values,
+                      uint64_t epoch)
+{
+  const size_t bytes = entry_bytes(key, values);
+  if (bytes > m_config.max_bytes)
+    return;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (epoch != m_epoch.load(std::memory_order_relaxed))
+    return;
+
+  if (const auto it = m_index.find(key); it != m_index.end())
+    erase(it->second);
+
+  while (!m_lru.empty() && m_bytes + bytes > m_config.max_bytes)
+    erase(std::prev(m_lru.end()));
+
+  m_lru.push_front(entry{key, tables, values, clock::now() + ttl(tables), bytes});
+  m_index.emplace(std::move(key), m_lru.begin());
+  for (const auto& table : tables)
+    m_tables[table].insert(m_lru.front().key);
+  m_bytes += bytes;
+}
+//----------------------------------------------------
+void ResultCache::invalidate(const std::string& table)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_epoch.fetch_add(1, std::memory_order_release);
+
+  const auto it = m_tables.find(table);
+  if (it == m_tables.end())
+    return;
+
+  const std::unordered_set<std::string> keys = std::move(it->second);
+  m_tables.erase(it);
+  for (const auto& key : keys)
+    if (const auto found = m_index.find(key); found != m_index.end())
+      erase(found->second);
+}
+//----------------------------------------------------
+void ResultCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_epoch.fetch_add(1, std::memory_order_release);
+  m_lru   .clear();
+  m_index .clear();
+  m_tables.clear();
+  m_bytes = 0;
+}
+//----------------------------------------------------
+void ResultCache::erase(entries::iterator it)
+{
+  for (const auto& table : it->tables)
+    if (const auto keys = m_tables.find(table); keys != m_tables.end())
+    {
+      keys->second.erase(it->key);
+      if (keys->second.empty())
+        m_tables.erase(keys);
+    }
+
+  m_bytes -= it->bytes;
+  m_index.erase(it->key);
+  m_lru.erase(it);
+}
+//----------------------------------------------------
+CacheStats ResultCache::stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return CacheStats{
+    .hits    = m_hits  .load(std::memory_order_relaxed),
+    .misses  = m_misses.load(std::memory_order_relaxed),
+    .entries = m_lru.size(),
+    .bytes   = m_bytes};
+}
+} // ns kdb
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "result_set.hpp"
+
+namespace kdb
+{
+ResultSet::ResultSet(Fields names)
+: m_names(std::move(names))
+{
+  m_index.reserve(m_names.size());
+  for (size_t i = 0; i < m_names.size(); i++)
+    m_index.emplace(m_names[i], i);
+}
+//----------------------------------------------------
+/**
+ * Sized in one pass over the result and filled in a second. With a pool both passes are
+ * split into row chunks, and each chunk writes its own range of the arena, starting at
+ * the combined size of the chunks before it.
+ */
+ResultSet::ResultSet(const pqxx::result& result, Fields names, bool binary, thread_pool* pool)
+: ResultSet(std::move(names))
+{
+  m_binary = binary;
+  m_types.reserve(m_names.size());
+  for (size_t i = 0; i < m_names.size(); i++)
+    m_types.push_back((static_cast<int>(i) < result.columns()) ? result.column_type(static_cast<int>(i)) : pqxx::oid{});
+
+  const size_t        rows    = result.size();
+  const size_t        columns = m_names.size();
+  const size_t        chunk   = std::max<size_t>(1, rows / (((pool) ? pool->size() + 1 : 1) * 4));
+  std::vector<size_t> starts((rows + chunk - 1) / chunk + 1);
+  const auto          row_at  = [&result](size_t i) { return result[static_cast<pqxx::result::size_type>(i)]; };
+
+  for_chunks(pool, rows, chunk, [&](size_t first, size_t last)
+  {
+    size_t bytes{};
+    for (size_t i = first; i < last; i++)
+    {
+      const auto row = row_at(i);
+      for (size_t column = 0; column < columns && column < static_cast<size_t>(row.size()); column++)
+        bytes += row[static_cast<pqxx::row::size_type>(column)].size();
+    }
+    starts[first / chunk + 1] = bytes;
+  });
+  std::partial_sum(starts.begin(), starts.end(), starts.begin());
+
+  m_arena  .resize(starts.back());
+  m_offsets.resize(rows * columns + 1);
+  m_nulls  .resize(rows * columns);
+
+  for_chunks(pool, rows, chunk, [&](size_t first, size_t last)
+  {
+    size_t offset = starts[first / chunk];
+    for (size_t i = first; i < last; i++)
+    {
+      const auto row = row_at(i);
+      for (size_t column = 0; column < columns; column++)
+      {
+        const size_t value = i * columns + column;
+        if (column < static_cast<size_t>(row.size()) && !row[static_cast<pqxx::row::size_type>(column)].is_null())
+        {
+          const auto field = row[static_cast<pqxx::row::size_type>(column)];
+          std::copy_n(field.c_str(), field.size(), m_arena.data() + offset);
+          offset += field.size();
+        }
+        else
+          m_nulls[value] = true;
+        m_offsets[value + 1] = offset;
+      }
+    }
+  });
+}
+//----------------------------------------------------
+void ResultSet::reserve(size_t rows, size_t bytes)
+{
+  const size_t values = rows * m_names.size();
+  m_arena  .reserve(m_arena.size() + bytes);
+  m_offsets.reserve(m_offsets.size() + values);
+  m_nulls  .reserve(m_nulls.size() + values);
+}
+//----------------------------------------------------
+void ResultSet::append(std::string_view value)
+{
+  m_arena.append(value.data(), value.size());
+  m_offsets.push_back(m_arena.size());
+  m_nulls.push_back(0);
+}
+//----------------------------------------------------
+void ResultSet::append_null()
+{
+  m_offsets.push_back(m_arena.size());
+  m_nulls.push_back(1);
+}
+//----------------------------------------------------
+size_t ResultSet::rows() const
+{
+  return (m_names.empty()) ? 0 : m_nulls.size() / m_names.size();
+}
+//----------------------------------------------------
+size_t ResultSet::column(const std::string& name) const
+{
+  if (const auto it = m_index.find(name); it != m_index.end())
+    return it->second;
+  throw std::out_of_range{"No column named " + name + " in result set"};
+}
+//----------------------------------------------------
+std::string_view ResultSet::value(size_t row, size_t column) const
+{
+  const size_t i = row * m_names.size() + column;
+  return std::string_view{m_arena}.substr(m_offsets[i], m_offsets[i + 1] - m_offsets[i]);
+}
+//----------------------------------------------------
+bool ResultSet::is_null(size_t row, size_t column) const
+{
+  return m_nulls[row * m_names.size() + column];
+}
+//----------------------------------------------------
+size_t ResultSet::bytes() const
+{
+  return m_arena.capacity() + m_offsets.capacity() * sizeof(size_t) + m_nulls.capacity();
+}
+} // ns kdb
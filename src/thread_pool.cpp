@@ -0,0 +1,44 @@
+#include "thread_pool.hpp"
+
+namespace kdb
+{
+thread_pool::thread_pool(size_t threads)
+{
+  if (!threads)
+    threads = 1;
+
+  m_threads.reserve(threads);
+  for (size_t i = 0; i < threads; i++)
+    m_threads.emplace_back([this] { run(); });
+}
+//----------------------------------------------------
+thread_pool::~thread_pool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_ready.notify_all();
+
+  for (auto& thread : m_threads)
+    thread.join();
+}
+//----------------------------------------------------
+void thread_pool::run()
+{
+  for (;;)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_ready.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+      if (m_tasks.empty())
+        return;
+
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
+} // ns kdb
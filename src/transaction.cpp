@@ -0,0 +1,116 @@
+#include "transaction.hpp"
+#include "database_connection.hpp"
+#include "helpers.hpp"
+#include "results.hpp"
+
+namespace kdb
+{
+Transaction::Transaction(db_cxn& db, connection_pool::lease cxn)
+: m_db(db),
+  m_cxn(std::move(cxn)),
+  m_work(*m_cxn)
+{}
+//----------------------------------------------------
+pqxx::result Transaction::exec(const std::string& sql, const Binder& binder)
+{
+  return m_db.exec(m_cxn, m_work, sql, binder);
+}
+//----------------------------------------------------
+pqxx::result Transaction::write(const std::string& table, const std::string& sql, const Binder& binder)
+{
+  pqxx::result result = exec(sql, binder);
+  m_written.push_back(table);
+  return result;
+}
+//----------------------------------------------------
+QueryValues Transaction::select(const std::string& table, const Fields& fields, const QueryFilter& filter)
+{
+  Binder binder{m_db.m_config.prepare};
+  const DatabaseQuery query{
+    .table  = table,
+    .fields = fields,
+    .type   = QueryType::SELECT,
+    .values = {},
+    .filter = filter};
+  return to_values(exec(select_statement(query, binder), binder), fields);
+}
+//----------------------------------------------------
+bool Transaction::insert(const std::string& table, const Fields& fields, const Values& values)
+{
+  Binder binder{m_db.m_config.prepare};
+  const DatabaseQuery query{
+    .table  = table,
+    .fields = fields,
+    .type   = QueryType::INSERT,
+    .values = values,
+    .filter = QueryFilter{}};
+  write(table, insert_statement(query, binder), binder);
+  return true;
+}
+//----------------------------------------------------
+std::string Transaction::insert(const std::string& table, const Fields& fields, const Values& values,
+                                const std::string& returning)
+{
+  Binder binder{m_db.m_config.prepare};
+  const InsertReturnQuery query{
+    .table     = table,
+    .fields    = fields,
+    .type      = QueryType::INSERT,
+    .values    = values,
+    .returning = returning};
+  return first_value(write(table, insert_statement(query, returning, binder), binder));
+}
+//----------------------------------------------------
+std::string Transaction::update(const std::string& table, const Fields& fields, const Values& values,
+                                const QueryFilter& filter, const std::string& returning)
+{
+  Binder binder{m_db.m_config.prepare};
+  const UpdateReturnQuery query{
+    .table     = table,
+    .fields    = fields,
+    .type      = QueryType::UPDATE,
+    .values    = values,
+    .filter    = filter,
+    .returning = returning};
+  return first_value(write(table, update_statement(query, returning, binder), binder));
+}
+//----------------------------------------------------
+std::string Transaction::remove(const std::string& table, const QueryFilter& filter)
+{
+  Binder binder{m_db.m_config.prepare};
+  const DatabaseQuery query{
+    .table  = table,
+    .fields = {},
+    .type   = QueryType::DELETE,
+    .values = {},
+    .filter = filter};
+  return first_value(write(table, delete_statement(query, binder), binder));
+}
+//----------------------------------------------------
+void Transaction::savepoint(const std::string& name)
+{
+  m_work.exec("SAVEPOINT " + m_work.quote_name(name));
+}
+//----------------------------------------------------
+void Transaction::rollback_to(const std::string& name)
+{
+  m_work.exec("ROLLBACK TO SAVEPOINT " + m_work.quote_name(name));
+}
+//----------------------------------------------------
+void Transaction::release(const std::string& name)
+{
+  m_work.exec("RELEASE SAVEPOINT " + m_work.quote_name(name));
+}
+//----------------------------------------------------
+void Transaction::commit()
+{
+  m_work.commit();
+  for (const auto& table : m_written)
+    m_db.invalidate(table);
+}
+//----------------------------------------------------
+void Transaction::abort()
+{
+  m_work.abort();
+}
+} // ns kdb
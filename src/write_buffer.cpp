@@ -0,0 +1,256 @@
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+#include "write_buffer.hpp"
+#include "database_connection.hpp"
+
+namespace kdb
+{
+WriteBuffer::WriteBuffer(db_cxn& db, std::string table, Fields fields, bufferconfig config)
+: m_db(db),
+  m_table(std::move(table)),
+  m_fields(std::move(fields)),
+  m_config(config)
+{
+  if (m_table.empty() || m_fields.empty())
+    throw std::invalid_argument{"WriteBuffer needs a table and its fields"};
+
+  m_flusher = std::thread{[this] { run(); }};
+}
+//----------------------------------------------------
+WriteBuffer::~WriteBuffer()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  m_room.notify_all();
+  m_flusher.join();
+
+  // The flusher's last write took everything queued before it; anything a producer
+  // linked in after that is dropped, not leaked
+  while (node* n = pop())
+  {
+    m_dropped++;
+    delete n;
+  }
+
+  if (m_error)
+  {
+    try
+    {
+      std::rethrow_exception(m_error);
+    }
+    catch (const std::exception& e)
+    {
+      std::cerr << "Unreported WriteBuffer failure for " << m_table << ": " << e.what() << std::endl;
+    }
+  }
+}
+//----------------------------------------------------
+/**
+ * Queues one row, a value for each field. Returns false when the row was dropped by
+ * the DROP overflow policy, or by BLOCK because the buffer is being destroyed.
+ */
+bool WriteBuffer::insert(Values row)
+{
+  if (row.size() != m_fields.size())
+    throw std::invalid_argument{"WriteBuffer rows need one value per field"};
+
+  if (m_rows.load(std::memory_order_acquire) >= m_config.capacity)
+  {
+    switch (m_config.overflow)
+    {
+      case BufferOverflow::DROP:
+        m_dropped++;
+        return false;
+
+      case BufferOverflow::THROW:
+        throw std::length_error{"WriteBuffer for " + m_table + " is full"};
+
+      case BufferOverflow::BLOCK:
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.notify_one();
+        m_room.wait(lock, [this] { return m_stop || m_rows.load() < m_config.capacity; });
+        if (m_stop)
+        {
+          m_dropped++;
+          return false;
+        }
+      }
+    }
+  }
+
+  auto n = new node;
+  for (const auto& value : row)
+    n->bytes += value.size();
+  n->row = std::move(row);
+
+  const size_t rows  = m_rows.fetch_add(1) + 1;
+  const size_t bytes = m_bytes.fetch_add(n->bytes) + n->bytes;
+  push(n);
+
+  if (rows >= m_config.max_rows || bytes >= m_config.max_bytes)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_wake.notify_one();
+  }
+  return true;
+}
+//----------------------------------------------------
+/**
+ * Writes every row queued before the call and waits for it. Rethrows a failure of this
+ * or an earlier background flush, unless an error handler took it.
+ */
+void WriteBuffer::flush()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    write();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_error)
+    std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+//----------------------------------------------------
+void WriteBuffer::on_error(ErrorHandler handler)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_on_error = std::move(handler);
+}
+//----------------------------------------------------
+BufferStats WriteBuffer::stats() const
+{
+  return BufferStats{m_written.load(), m_dropped.load(), m_flushes.load(), m_failures.load(), m_rows.load()};
+}
+//----------------------------------------------------
+void WriteBuffer::push(node* n)
+{
+  n->next.store(nullptr, std::memory_order_relaxed);
+  node* prev = m_head.exchange(n, std::memory_order_acq_rel);
+  prev->next.store(n, std::memory_order_release);
+}
+//----------------------------------------------------
+/**
+ * Takes the oldest row, or nullptr when the queue is empty or its oldest row is still
+ * being linked in by a producer; that row is picked up by the next write.
+ */
+WriteBuffer::node* WriteBuffer::pop()
+{
+  node* tail = m_tail;
+  node* next = tail->next.load(std::memory_order_acquire);
+  if (tail == &m_stub)
+  {
+    if (!next)
+      return nullptr;
+    m_tail = next;
+    tail   = next;
+    next   = next->next.load(std::memory_order_acquire);
+  }
+
+  if (next)
+  {
+    m_tail = next;
+    return tail;
+  }
+
+  if (tail != m_head.load(std::memory_order_acquire))
+    return nullptr;
+
+  push(&m_stub);
+  next = tail->next.load(std::memory_order_acquire);
+  if (!next)
+    return nullptr;
+  m_tail = next;
+  return tail;
+}
+//----------------------------------------------------
+void WriteBuffer::run()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop)
+  {
+    m_wake.wait_for(lock, m_config.interval, [this]
+    {
+      return m_stop || m_rows.load() >= m_config.max_rows || m_bytes.load() >= m_config.max_bytes;
+    });
+    lock.unlock();
+    {
+      std::lock_guard<std::mutex> write_lock(m_write_mutex);
+      write();
+    }
+    lock.lock();
+  }
+  lock.unlock();
+
+  std::lock_guard<std::mutex> write_lock(m_write_mutex);
+  write();
+}
+//----------------------------------------------------
+/**
+ * Drains the queue into one insert. Room is only given back to blocked producers once
+ * the rows are written, which keeps memory bounded by about `capacity` rows.
+ */
+void WriteBuffer::write()
+{
+  Values values;
+  size_t rows{};
+  size_t bytes{};
+  values.reserve(m_rows.load() * m_fields.size());
+  while (node* n = pop())
+  {
+    for (auto& value : n->row)
+      values.emplace_back(std::move(value));
+    rows++;
+    bytes += n->bytes;
+    delete n;
+  }
+
+  if (!rows)
+    return;
+
+  ErrorHandler handler;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    handler = m_on_error;
+  }
+
+  try
+  {
+    DatabaseQuery query{
+      .table  = m_table,
+      .fields = m_fields,
+      .type   = QueryType::INSERT,
+      .values = {}};
+    if (handler)
+      query.values = values; // kept for the handler
+    else
+      query.values = std::move(values);
+    m_db.query(std::move(query));
+    m_written += rows;
+  }
+  catch (...)
+  {
+    m_failures++;
+    if (handler)
+      handler(values, std::current_exception());
+    else
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_error = std::current_exception();
+    }
+  }
+
+  m_flushes++;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_rows  -= rows;
+    m_bytes -= bytes;
+  }
+  m_room.notify_all();
+}
+} // ns kdb
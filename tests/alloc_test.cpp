@@ -0,0 +1,154 @@
+#include <cstdlib>
+#include <new>
+
+#include "check.hpp"
+#include "helpers.hpp"
+
+using namespace kdb;
+
+//  ┌──────────────────────────────────────────┐  //
+//  │░░░░░░░░░░░░░░ Allocations ░░░░░░░░░░░░░░░░│  //
+//  └──────────────────────────────────────────┘  //
+static size_t g_allocations{0};
+
+__attribute__((noinline)) static void* counted_new(size_t size)
+{
+  g_allocations++;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc{};
+}
+
+__attribute__((noinline)) void* operator new  (size_t size) { return counted_new(size); }
+__attribute__((noinline)) void* operator new[](size_t size) { return counted_new(size); }
+__attribute__((noinline)) void* operator new  (size_t size, const std::nothrow_t&) noexcept
+{
+  try { return counted_new(size); } catch (...) { return nullptr; }
+}
+__attribute__((noinline)) void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+  try { return counted_new(size); } catch (...) { return nullptr; }
+}
+
+__attribute__((noinline)) void operator delete  (void* p)                        noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p)                        noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete  (void* p, size_t)                noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, size_t)                noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete  (void* p, const std::nothrow_t&) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+namespace
+{
+template <typename F>
+size_t allocations(F&& f)
+{
+  const size_t before = g_allocations;
+  f();
+  return g_allocations - before;
+}
+//----------------------------------------------------
+const Fields g_fields{"id", "name", "value"};
+//----------------------------------------------------
+DatabaseQuery make_select()
+{
+  return DatabaseQuery{
+    .table  = "tasks",
+    .fields = g_fields,
+    .type   = QueryType::SELECT,
+    .values = {},
+    .filter = CreateFilter("name", "task", "value", "10"),
+    .order  = {"id", "ASC"},
+    .limit  = {"100", ""}};
+}
+//----------------------------------------------------
+// KDB methods take sink parameters and move them into the query: no copies on the way
+void sink_arguments_move_into_query()
+{
+  std::string table{"a_table_name_longer_than_sso"};
+  Fields      fields{"a_field_name_longer_than_sso", "another_long_field_name"};
+  QueryFilter filter = CreateFilter("a_filter_key_longer_than_sso", "a_filter_value_longer_than_sso");
+
+  const size_t moved = allocations([&]
+  {
+    const DatabaseQuery query{
+      .table  = std::move(table),
+      .fields = std::move(fields),
+      .type   = QueryType::SELECT,
+      .values = {},
+      .filter = std::move(filter),
+      .order  = {},
+      .limit  = {}};
+  });
+  KDB_CHECK_EQ(moved, size_t{0});
+}
+//----------------------------------------------------
+// With a warm arena, a literal statement costs one allocation: the string str() returns
+void literal_statements_allocate_once()
+{
+  const DatabaseQuery select = make_select();
+  DatabaseQuery       insert{
+    .table  = "tasks",
+    .fields = {"name", "value"},
+    .type   = QueryType::INSERT,
+    .values = {"row 1", "1", "row 2", "2"},
+    .filter = {},
+    .order  = {},
+    .limit  = {}};
+  DatabaseQuery remove = select;
+  remove.type          = QueryType::DELETE;
+
+  const auto build = [](const auto& statement)
+  {
+    statement(); // warm the arena
+    return allocations(statement);
+  };
+
+  KDB_CHECK_EQ(build([&] { Binder b{}; return select_statement(select, b); }), size_t{1});
+  KDB_CHECK_EQ(build([&] { Binder b{}; return insert_statement(insert, b); }), size_t{1});
+  KDB_CHECK_EQ(build([&] { Binder b{}; return delete_statement(remove, b); }), size_t{1});
+}
+//----------------------------------------------------
+// Preparing adds only the Binder's own copy of the values, never a copy of the query
+void prepared_statements_copy_values_once()
+{
+  const DatabaseQuery query = make_select();
+  const auto          build = [&] { Binder b{true}; return select_statement(query, b); };
+  build();
+
+  const size_t values = allocations([]
+  {
+    StringVec bound;
+    bound.emplace_back("task");
+    bound.emplace_back("10");
+  });
+  KDB_CHECK_EQ(allocations(build), 1 + values);
+}
+//----------------------------------------------------
+// A statement above the arena's keep size is not pinned on the thread afterwards
+void large_statement_releases_arena()
+{
+  DatabaseQuery insert{
+    .table  = "tasks",
+    .fields = {"name"},
+    .type   = QueryType::INSERT,
+    .values = StringVec(20000, "a value of some length"),
+    .filter = {},
+    .order  = {},
+    .limit  = {}};
+  const DatabaseQuery select = make_select();
+
+  { Binder b{}; select_statement(select, b); }
+  { Binder b{}; insert_statement(insert, b); }
+  // the arena was released, so the next statement grows a fresh buffer before its copy
+  KDB_CHECK(allocations([&] { Binder b{}; return select_statement(select, b); }) > 1);
+}
+} // ns
+
+int main()
+{
+  sink_arguments_move_into_query();
+  literal_statements_allocate_once();
+  prepared_statements_copy_values_once();
+  large_statement_releases_arena();
+  return (g_failures) ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+#include "check.hpp"
+#include "helpers.hpp"
+#include "result_cache.hpp"
+
+using namespace kdb;
+
+namespace
+{
+const Join g_owner{"owners", "id", "tasks", "owner", INNER};
+//----------------------------------------------------
+template <typename T>
+void cache_join(ResultCache& cache, const T& query, std::string& key)
+{
+  Binder binder{};
+  key = select_statement(query, binder);
+  cache.put(key, query_tables(query), QueryValues{ResultMap{{"tasks.id", "1"}}}, cache.epoch());
+}
+//----------------------------------------------------
+// selectJoin builds a JoinQuery; a write to the joined table must evict it
+void joined_table_write_evicts_join_query()
+{
+  const JoinQuery<QueryFilter> query{
+    .table  = "tasks",
+    .fields = {"tasks.id", "owners.name"},
+    .filter = CreateFilter("tasks.done", "false"),
+    .joins  = {g_owner, Join{"teams", "id", "owners", "team", OUTER}},
+    .order  = {},
+    .limit  = {}};
+
+  const std::vector<std::string> expected{"tasks", "owners", "teams"};
+  KDB_CHECK(query_tables(query) == expected);
+
+  for (const auto& written : expected)
+  {
+    ResultCache cache{cacheconfig{.max_bytes = 1 << 20}};
+    std::string key;
+    cache_join(cache, query, key);
+    KDB_CHECK(cache.get(key).has_value());
+
+    cache.invalidate(written);
+    KDB_CHECK(!cache.get(key).has_value());
+  }
+}
+//----------------------------------------------------
+void joined_table_write_evicts_simple_join()
+{
+  const SimpleJoinQuery query{
+    .table  = "tasks",
+    .fields = {"tasks.id", "owners.name"},
+    .filter = {},
+    .join   = g_owner,
+    .order  = {},
+    .limit  = {}};
+
+  const std::vector<std::string> expected{"tasks", "owners"};
+  KDB_CHECK(query_tables(query) == expected);
+
+  ResultCache cache{cacheconfig{.max_bytes = 1 << 20}};
+  std::string key;
+  cache_join(cache, query, key);
+  cache.invalidate("owners");
+  KDB_CHECK(!cache.get(key).has_value());
+}
+//----------------------------------------------------
+void unrelated_write_keeps_join()
+{
+  const JoinQuery<QueryFilter> query{
+    .table  = "tasks",
+    .fields = {"tasks.id"},
+    .filter = {},
+    .joins  = {g_owner},
+    .order  = {},
+    .limit  = {}};
+
+  ResultCache cache{cacheconfig{.max_bytes = 1 << 20}};
+  std::string key;
+  cache_join(cache, query, key);
+  cache.invalidate("teams");
+  KDB_CHECK(cache.get(key).has_value());
+}
+} // ns
+
+int main()
+{
+  joined_table_write_evicts_join_query();
+  joined_table_write_evicts_simple_join();
+  unrelated_write_keeps_join();
+  return (g_failures) ? 1 : 0;
+}
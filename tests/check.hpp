@@ -0,0 +1,30 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+// Just enough to fail a ctest run with the expression and its location.
+inline int g_failures{0};
+
+#define KDB_CHECK(expr)                                                                  \
+  do                                                                                     \
+  {                                                                                      \
+    if (!(expr))                                                                         \
+    {                                                                                    \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": check failed: " #expr << std::endl; \
+      g_failures++;                                                                      \
+    }                                                                                    \
+  } while (0)
+
+#define KDB_CHECK_EQ(actual, expected)                                                   \
+  do                                                                                     \
+  {                                                                                      \
+    const auto& a_ = (actual);                                                           \
+    const auto& e_ = (expected);                                                         \
+    if (!(a_ == e_))                                                                     \
+    {                                                                                    \
+      std::cerr << __FILE__ << ':' << __LINE__ << ": " #actual "\n  expected: " << e_    \
+                << "\n  actual:   " << a_ << std::endl;                                  \
+      g_failures++;                                                                      \
+    }                                                                                    \
+  } while (0)
@@ -0,0 +1,147 @@
+#include "check.hpp"
+#include "helpers.hpp"
+#include "pager.hpp"
+#include <stdexcept>
+
+using namespace kdb;
+
+namespace
+{
+const Fields g_fields{"id", "name", "value"};
+//----------------------------------------------------
+template <typename T>
+std::string sql(const T& query, bool prepare)
+{
+  Binder binder{prepare};
+  return select_statement(query, binder);
+}
+//----------------------------------------------------
+void database_query_offset()
+{
+  const DatabaseQuery query{
+    .table  = "tasks",
+    .fields = g_fields,
+    .type   = QueryType::SELECT,
+    .values = {},
+    .filter = CreateFilter("name", "task"),
+    .order  = {"id", "ASC"},
+    .limit  = {"", "20"}};
+
+  KDB_CHECK_EQ(sql(query, false),
+               std::string{"SELECT id,name,value FROM tasks WHERE name='task' ORDER BY id ASC OFFSET 20"});
+  KDB_CHECK_EQ(sql(query, true),
+               std::string{"SELECT id,name,value FROM tasks WHERE name=$1 ORDER BY id ASC OFFSET 20"});
+}
+//----------------------------------------------------
+void database_query_without_bounds()
+{
+  const DatabaseQuery query{
+    .table  = "tasks",
+    .fields = g_fields,
+    .type   = QueryType::SELECT,
+    .values = {},
+    .filter = {},
+    .order  = {},
+    .limit  = {}};
+
+  KDB_CHECK_EQ(sql(query, false), std::string{"SELECT id,name,value FROM tasks"});
+  KDB_CHECK_EQ(sql(query, true),  std::string{"SELECT id,name,value FROM tasks"});
+}
+//----------------------------------------------------
+void multi_filter_select()
+{
+  const MultiFilterSelect query{
+    .table  = "tasks",
+    .fields = g_fields,
+    .filter = {GenericFilter{"value", "10", ">"}, GenericFilter{"name", "'task'", "="}},
+    .order  = {"value", "DESC"},
+    .limit  = {"50", "100"}};
+
+  KDB_CHECK_EQ(sql(query, false), std::string{"SELECT id,name,value FROM tasks WHERE value>10 AND name='task' "
+                                              "ORDER BY value DESC LIMIT 50 OFFSET 100"});
+  KDB_CHECK_EQ(sql(query, true),  std::string{"SELECT id,name,value FROM tasks WHERE value>10 AND name='task' "
+                                              "ORDER BY value DESC LIMIT 50 OFFSET 100"});
+}
+//----------------------------------------------------
+void join_query_order_limit()
+{
+  JoinQuery<std::vector<QueryFilter>> query;
+  query.table  = "tasks";
+  query.fields = {"tasks.id", "owners.name"};
+  query.filter = {CreateFilter("tasks.name", "task")};
+  query.joins  = {Join{"owners", "id", "tasks", "owner", INNER}};
+  query.order  = {"tasks.id", "DESC"};
+  query.limit  = {"10", ""};
+
+  KDB_CHECK_EQ(sql(query, false), std::string{"SELECT tasks.id,owners.name FROM tasks INNER JOIN owners ON "
+                                              "owners.id=tasks.owner WHERE tasks.name='task' "
+                                              "ORDER BY tasks.id DESC LIMIT 10"});
+  KDB_CHECK_EQ(sql(query, true),  std::string{"SELECT tasks.id,owners.name FROM tasks INNER JOIN owners ON "
+                                              "owners.id=tasks.owner WHERE tasks.name=$1 "
+                                              "ORDER BY tasks.id DESC LIMIT 10"});
+}
+//----------------------------------------------------
+// Empty values are bound as 'NULL' like inserts, so the prepared text never changes
+void bulk_update_binds_empty_values()
+{
+  BulkUpdateQuery query;
+  query.table  = "tasks";
+  query.keys   = {"id"};
+  query.fields = {"name"};
+  query.values = {"1", "", "2", "task"};
+  const ColumnTypes types{{"id", "integer"}, {"name", "text"}};
+
+  Binder literal{};
+  KDB_CHECK_EQ(bulk_update_statement(query, 0, 2, types, literal),
+               std::string{"UPDATE tasks SET name=kdb_v.name::text FROM (VALUES ('1','NULL'),('2','task')) "
+                           "AS kdb_v(id,name) WHERE tasks.id=kdb_v.id::integer RETURNING tasks.id"});
+
+  Binder prepared{true};
+  KDB_CHECK_EQ(bulk_update_statement(query, 0, 2, types, prepared),
+               std::string{"UPDATE tasks SET name=kdb_v.name::text FROM (VALUES ($1,$2),($3,$4)) "
+                           "AS kdb_v(id,name) WHERE tasks.id=kdb_v.id::integer RETURNING tasks.id"});
+  KDB_CHECK(prepared.values == (StringVec{"1", "NULL", "2", "task"}));
+}
+//----------------------------------------------------
+// The page flags rows with a NULL key so the Pager can refuse them
+void keyset_page_flags_null_keys()
+{
+  KeysetQuery<DatabaseQuery> page;
+  page.table       = "tasks";
+  page.fields      = {"id", "name"};
+  page.query.table = "tasks";
+  page.keys        = {"name", "id"};
+  page.after       = {"a", "7"};
+  page.size        = 10;
+
+  KDB_CHECK_EQ(sql(page, true),
+               std::string{"SELECT *,(kdb_k0 IS NULL OR kdb_k1 IS NULL) AS kdb_null_key FROM "
+                           "(SELECT id AS kdb_k1,name AS kdb_k0 FROM tasks) AS kdb_page "
+                           "WHERE (kdb_k0,kdb_k1) > ($1,$2) ORDER BY kdb_k0 ASC,kdb_k1 ASC LIMIT 11"});
+  KDB_CHECK(result_fields(page) == (Fields{"id", "name", "kdb_null_key"}));
+}
+//----------------------------------------------------
+void continuation_token_round_trip()
+{
+  const StringVec values{"", "a\xff" "b"};
+  KDB_CHECK(!encode_token({""}).empty());
+  KDB_CHECK(decode_token(encode_token({""})) == StringVec{""});
+  KDB_CHECK(decode_token(encode_token(values)) == values);
+
+  bool threw{false};
+  try { decode_token(""); } catch (const std::invalid_argument&) { threw = true; }
+  KDB_CHECK(threw);
+}
+} // ns
+
+int main()
+{
+  database_query_offset();
+  database_query_without_bounds();
+  multi_filter_select();
+  join_query_order_limit();
+  bulk_update_binds_empty_values();
+  keyset_page_flags_null_keys();
+  continuation_token_round_trip();
+  return (g_failures) ? 1 : 0;
+}